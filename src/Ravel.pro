@@ -66,16 +66,23 @@ SOURCES  += main.cpp \
     counter.cpp \
     counterrecord.cpp \
     charmimporter.cpp \
+    logpipeline.cpp \
     otf2importer.cpp \
     otf2exporter.cpp \
     otf2exportfunctor.cpp \
+    savedresults.cpp \
     metrics.cpp \
     entity.cpp \
     primaryentitygroup.cpp \
     entitygroup.cpp \
     clusterentity.cpp \
     importoptions.cpp \
-    importfunctor.cpp
+    importfunctor.cpp \
+    timelod.cpp \
+    barbuffer.cpp \
+    tilecache.cpp \
+    framestats.cpp \
+    batchrenderer.cpp
 
 HEADERS += \
     trace.h \
@@ -115,9 +122,11 @@ HEADERS += \
     counter.h \
     counterrecord.h \
     charmimporter.h \
+    logpipeline.h \
     otf2importer.h \
     otf2exporter.h \
     otf2exportfunctor.h \
+    savedresults.h \
     metrics.h \
     entity.h \
     primaryentitygroup.h \
@@ -125,7 +134,13 @@ HEADERS += \
     clusterentity.h \
     ravelutils.h \
     importoptions.h \
-    importfunctor.h
+    importfunctor.h \
+    timelod.h \
+    barbuffer.h \
+    tilecache.h \
+    hitgrid.h \
+    framestats.h \
+    batchrenderer.h
 
 FORMS += \
     mainwindow.ui \
@@ -146,6 +161,12 @@ contains(DEFINES, OTF1LIB) {
     macx: LIBS += -L$${HOME}/opt/lib -lopen-trace-format
 }
 
+# SVG output from --render is optional
+qtHaveModule(svg) {
+    QT += svg
+    DEFINES += SVGLIB
+}
+
 LIBS += -lz
 
 unix: INCLUDEPATH += $${HOME}/opt/include
@@ -0,0 +1,207 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "barbuffer.h"
+#include <QGLShaderProgram>
+#include <iostream>
+
+// Expand each corner away from the bar's center and apply the overall
+// opacity on top of the per-bar alpha
+static const char * bar_vertex_shader =
+        "attribute vec4 vertex;\n"
+        "attribute vec4 color;\n"
+        "uniform mat4 projection;\n"
+        "uniform vec2 expand;\n"
+        "uniform float opacity;\n"
+        "varying vec4 bar_color;\n"
+        "void main()\n"
+        "{\n"
+        "    bar_color = vec4(color.rgb, color.a * opacity);\n"
+        "    gl_Position = projection\n"
+        "                  * vec4(vertex.xy + vertex.zw * expand, 0.0, 1.0);\n"
+        "}\n";
+
+static const char * bar_fragment_shader =
+        "varying vec4 bar_color;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = bar_color;\n"
+        "}\n";
+
+BarBuffer::BarBuffer()
+    : valid(false),
+      num_bars(0),
+      program_failed(false),
+      vertices(QVector<GLfloat>()),
+      colors(QVector<GLfloat>()),
+      vertexBuffer(QGLBuffer::VertexBuffer),
+      colorBuffer(QGLBuffer::VertexBuffer),
+      program(NULL)
+{
+
+}
+
+BarBuffer::~BarBuffer()
+{
+    vertexBuffer.destroy();
+    colorBuffer.destroy();
+    delete program;
+}
+
+void BarBuffer::clear()
+{
+    vertices.clear();
+    colors.clear();
+    num_bars = 0;
+    valid = false;
+}
+
+void BarBuffer::addBar(float x, float y, float w, float h,
+                       const QColor& color, float alpha)
+{
+    vertices.append(x);
+    vertices.append(y);
+    vertices.append(-1);
+    vertices.append(-1);
+    vertices.append(x);
+    vertices.append(y + h);
+    vertices.append(-1);
+    vertices.append(1);
+    vertices.append(x + w);
+    vertices.append(y + h);
+    vertices.append(1);
+    vertices.append(1);
+    vertices.append(x + w);
+    vertices.append(y);
+    vertices.append(1);
+    vertices.append(-1);
+    for (int j = 0; j < 4; ++j)
+    {
+        colors.append(color.red() / 255.0);
+        colors.append(color.green() / 255.0);
+        colors.append(color.blue() / 255.0);
+        colors.append(alpha);
+    }
+    num_bars++;
+}
+
+// Must be called with the widget's context current. The staged bars are
+// released once they are on the GPU.
+void BarBuffer::upload()
+{
+    if (!vertexBuffer.isCreated())
+    {
+        vertexBuffer.create();
+        vertexBuffer.setUsagePattern(QGLBuffer::StaticDraw);
+        colorBuffer.create();
+        colorBuffer.setUsagePattern(QGLBuffer::StaticDraw);
+    }
+
+    vertexBuffer.bind();
+    vertexBuffer.allocate(vertices.constData(),
+                          vertices.size() * sizeof(GLfloat));
+    vertexBuffer.release();
+
+    colorBuffer.bind();
+    colorBuffer.allocate(colors.constData(), colors.size() * sizeof(GLfloat));
+    colorBuffer.release();
+
+    vertices.clear();
+    vertices.squeeze();
+    colors.clear();
+    colors.squeeze();
+    valid = true;
+}
+
+bool BarBuffer::initProgram()
+{
+    if (program)
+        return true;
+    if (program_failed)
+        return false;
+
+    program = new QGLShaderProgram();
+    program->addShaderFromSourceCode(QGLShader::Vertex, bar_vertex_shader);
+    program->addShaderFromSourceCode(QGLShader::Fragment, bar_fragment_shader);
+    program->bindAttributeLocation("vertex", 0);
+    program->bindAttributeLocation("color", 1);
+    if (!program->link())
+    {
+        std::cout << "Bar shaders unavailable, drawing without overplotting: "
+                  << program->log().toStdString() << std::endl;
+        delete program;
+        program = NULL;
+        program_failed = true;
+        return false;
+    }
+    return true;
+}
+
+// Draw count bars starting at bar first
+void BarBuffer::draw(const QMatrix4x4& projection, int first, int count,
+                     float opacity, float xexpand, float yexpand)
+{
+    if (!valid || count <= 0)
+        return;
+
+    if (initProgram())
+    {
+        program->bind();
+        program->setUniformValue("projection", projection);
+        program->setUniformValue("expand", xexpand, yexpand);
+        program->setUniformValue("opacity", opacity);
+
+        vertexBuffer.bind();
+        program->enableAttributeArray(0);
+        program->setAttributeBuffer(0, GL_FLOAT, 0, 4);
+        colorBuffer.bind();
+        program->enableAttributeArray(1);
+        program->setAttributeBuffer(1, GL_FLOAT, 0, 4);
+
+        glDrawArrays(GL_QUADS, first * 4, count * 4);
+
+        program->disableAttributeArray(0);
+        program->disableAttributeArray(1);
+        colorBuffer.release();
+        program->release();
+    }
+    else // Fixed function fallback
+    {
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glLoadMatrixf(projection.constData());
+
+        glEnableClientState(GL_COLOR_ARRAY);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        vertexBuffer.bind();
+        glVertexPointer(2, GL_FLOAT, 4 * sizeof(GLfloat), 0);
+        colorBuffer.bind();
+        glColorPointer(4, GL_FLOAT, 0, 0);
+        glDrawArrays(GL_QUADS, first * 4, count * 4);
+        colorBuffer.release();
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glPopMatrix();
+    }
+}
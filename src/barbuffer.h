@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef BARBUFFER_H
+#define BARBUFFER_H
+
+#include <QVector>
+#include <QColor>
+#include <QMatrix4x4>
+#include <QGLBuffer>
+
+class QGLShaderProgram;
+
+// Bars for the native GL paths, kept on the GPU between paints. Vertices are
+// in the vis's own coordinates (e.g. step and entity order) so panning and
+// zooming only change the projection. Each vertex also knows which corner
+// of its bar it is so overplotting expansion is applied when drawing.
+class BarBuffer
+{
+public:
+    BarBuffer();
+    ~BarBuffer();
+
+    // Staging of bars before upload
+    void clear();
+    void addBar(float x, float y, float w, float h, const QColor& color,
+                float alpha = 1.0);
+    int numBars() { return num_bars; }
+    void upload();
+
+    void draw(const QMatrix4x4& projection, int first, int count,
+              float opacity = 1.0, float xexpand = 0, float yexpand = 0);
+
+    // Whether what is on the GPU is current
+    bool isValid() { return valid; }
+    void invalidate() { valid = false; }
+
+private:
+    bool initProgram();
+
+    bool valid;
+    int num_bars;
+    bool program_failed;
+    QVector<GLfloat> vertices; // x, y, corner x, corner y
+    QVector<GLfloat> colors; // r, g, b, a
+    QGLBuffer vertexBuffer;
+    QGLBuffer colorBuffer;
+    QGLShaderProgram * program;
+};
+
+#endif // BARBUFFER_H
@@ -0,0 +1,375 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "batchrenderer.h"
+#include <iostream>
+#include <algorithm>
+#include <QImage>
+#include <QPainter>
+#ifdef SVGLIB
+#include <QSvgGenerator>
+#endif
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+
+#include "trace.h"
+#include "importoptions.h"
+#include "importfunctor.h"
+#include "visoptions.h"
+#include "viswidget.h"
+#include "stepvis.h"
+#include "traditionalvis.h"
+#include "overviewvis.h"
+#include "ravelutils.h"
+
+BatchRenderer::BatchRenderer(ImportOptions * _importoptions,
+                             VisOptions * _visoptions)
+    : QObject(),
+      importoptions(_importoptions),
+      visoptions(_visoptions),
+      trace(NULL),
+      startStep(0),
+      stopStep(-1),
+      startTime(0),
+      stopTime(0)
+{
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    delete trace;
+}
+
+bool BatchRenderer::viewFromName(QString name, ViewType& view)
+{
+    if (name == "step")
+        view = VIEW_STEP;
+    else if (name == "physical")
+        view = VIEW_TIME;
+    else if (name == "overview")
+        view = VIEW_OVERVIEW;
+    else
+        return false;
+    return true;
+}
+
+// Import and process the trace the same way the GUI does, but on this
+// thread since there is no progress to show
+bool BatchRenderer::loadTrace(QString dataFileName)
+{
+    delete trace;
+    trace = NULL;
+
+    ImportFunctor * importWorker = new ImportFunctor(importoptions);
+    connect(importWorker, SIGNAL(done(Trace *)), this,
+            SLOT(traceFinished(Trace *)));
+    if (dataFileName.endsWith("otf", Qt::CaseInsensitive))
+    {
+        importoptions->origin = ImportOptions::OF_OTF;
+        importWorker->doImportOTF(dataFileName);
+    }
+    else if (dataFileName.endsWith("otf2", Qt::CaseInsensitive))
+    {
+        importoptions->origin = ImportOptions::OF_OTF2;
+        importoptions->waitallMerge = false; // Not applicable
+        importWorker->doImportOTF2(dataFileName);
+    }
+    else if (dataFileName.endsWith("sts", Qt::CaseInsensitive))
+    {
+        importoptions->origin = ImportOptions::OF_CHARM;
+        importoptions->waitallMerge = false; // Not applicable
+        importoptions->leapMerge = false;
+        importoptions->isendCoalescing = false;
+        importoptions->callerMerge = false;
+        importoptions->advancedStepping = false;
+        visoptions->showAggregateSteps = false;
+        importWorker->doImportCharm(dataFileName);
+    }
+    else
+    {
+        std::cout << "Unrecognized trace format!" << std::endl;
+    }
+    delete importWorker;
+
+    if (!trace)
+        return false;
+
+    trace->name = QFileInfo(dataFileName).fileName();
+    if (!trace->metrics->contains(visoptions->metric))
+    {
+        if (trace->options.origin == ImportOptions::OF_CHARM)
+            visoptions->metric = "Duration";
+        else
+            visoptions->metric = "Lateness";
+    }
+    return true;
+}
+
+void BatchRenderer::traceFinished(Trace * _trace)
+{
+    if (_trace && _trace->partitions->size() < 1)
+    {
+        std::cout << "No communication phases found. Abandoning trace."
+                  << std::endl;
+        delete _trace;
+        _trace = NULL;
+    }
+    trace = _trace;
+}
+
+void BatchRenderer::setStepWindow(float start, float stop)
+{
+    startStep = start;
+    stopStep = stop;
+}
+
+void BatchRenderer::setTimeWindow(unsigned long long start,
+                                  unsigned long long stop)
+{
+    startTime = start;
+    stopTime = stop;
+}
+
+bool BatchRenderer::parseStepWindow(QString text, float& start, float& stop)
+{
+    QStringList steps = text.split(':');
+    bool startOk = false, stopOk = false;
+    if (steps.size() == 2)
+    {
+        start = steps[0].toFloat(&startOk);
+        stop = steps[1].toFloat(&stopOk);
+    }
+    return startOk && stopOk && start <= stop;
+}
+
+bool BatchRenderer::parseTimeWindow(QString text, unsigned long long& start,
+                                    unsigned long long& stop)
+{
+    QStringList times = text.split(':');
+    bool startOk = false, stopOk = false;
+    if (times.size() == 2)
+    {
+        start = times[0].toULongLong(&startOk);
+        stop = times[1].toULongLong(&stopOk);
+    }
+    return startOk && stopOk && start <= stop;
+}
+
+bool BatchRenderer::loadReplay(QString filename)
+{
+    replayWindows.clear();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        std::cout << "Could not read replay script "
+                  << filename.toStdString().c_str() << std::endl;
+        return false;
+    }
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QStringList fields = line.split(' ', QString::SkipEmptyParts);
+        ReplayWindow window;
+        window.physical = false;
+        window.startStep = 0;
+        window.stopStep = 0;
+        window.startTime = 0;
+        window.stopTime = 0;
+        bool ok = false;
+        if (fields.size() == 2 && fields[0] == "steps")
+        {
+            ok = parseStepWindow(fields[1], window.startStep,
+                                 window.stopStep);
+        }
+        else if (fields.size() == 2 && fields[0] == "time")
+        {
+            window.physical = true;
+            ok = parseTimeWindow(fields[1], window.startTime,
+                                 window.stopTime);
+        }
+        if (!ok)
+        {
+            std::cout << "Bad replay line " << lineNumber << ": "
+                      << line.toStdString().c_str() << std::endl;
+            replayWindows.clear();
+            return false;
+        }
+        replayWindows.append(window);
+    }
+
+    if (replayWindows.isEmpty())
+    {
+        std::cout << "Replay script has no windows." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+VisWidget * BatchRenderer::createView(ViewType view)
+{
+    if (view == VIEW_STEP)
+        return new StepVis(NULL, visoptions);
+    else if (view == VIEW_TIME)
+        return new TraditionalVis(NULL, visoptions);
+    return new OverviewVis(NULL, visoptions);
+}
+
+// Lay out a view at the requested size without showing it, at the window
+// set on the renderer
+VisWidget * BatchRenderer::setupView(ViewType view, QSize size)
+{
+    VisWidget * vis = createView(view);
+    vis->setClosed(true); // no repaints on the way
+    vis->resize(size);
+    vis->setTrace(trace);
+    vis->processVis();
+    if (stopStep >= 0)
+        vis->setSteps(startStep, stopStep, true);
+    else
+        vis->setSteps(0, trace->global_max_step, true);
+    if (view == VIEW_TIME && stopTime > 0)
+        static_cast<TraditionalVis *>(vis)->setTimeWindow(startTime, stopTime);
+    return vis;
+}
+
+// Paint the view into the file. SVG is chosen by extension, anything else is an image
+// format QImage knows.
+bool BatchRenderer::render(ViewType view, QString filename, QSize size)
+{
+    if (!trace)
+        return false;
+
+    QElapsedTimer renderTimer;
+    renderTimer.start();
+
+    VisWidget * vis = setupView(view, size);
+
+    bool saved = true;
+    if (filename.endsWith(".svg", Qt::CaseInsensitive))
+    {
+        #ifdef SVGLIB
+        QSvgGenerator generator;
+        generator.setFileName(filename);
+        generator.setSize(size);
+        generator.setViewBox(QRect(QPoint(0, 0), size));
+        generator.setTitle(trace->name);
+        QPainter painter(&generator);
+        vis->paintOffscreen(&painter);
+        painter.end();
+        #else
+        std::cout << "Ravel was built without SVG support." << std::endl;
+        saved = false;
+        #endif
+    }
+    else
+    {
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        vis->paintOffscreen(&painter);
+        painter.end();
+        saved = image.save(filename);
+    }
+
+    std::cout << filename.toStdString().c_str() << ": "
+              << vis->getFrameStats().summary().join(", ").toStdString().c_str()
+              << std::endl;
+    delete vis;
+
+    if (!saved)
+        std::cout << "Could not write " << filename.toStdString().c_str()
+                  << std::endl;
+    RavelUtils::gu_printTime(renderTimer.nsecsElapsed(), "Render: ");
+    return saved;
+}
+
+// Paint the view once per window of the replay script, as if the user had
+// panned and zoomed to each in turn, and report each frame's statistics.
+// Nothing is saved, the frames are only for timing.
+bool BatchRenderer::replay(ViewType view, QSize size)
+{
+    if (!trace || replayWindows.isEmpty())
+        return false;
+
+    VisWidget * vis = setupView(view, size);
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    qint64 totalTime = 0, maxTime = 0;
+    int frames = 0;
+    for (int i = 0; i < replayWindows.size(); i++)
+    {
+        const ReplayWindow& window = replayWindows.at(i);
+        QString label;
+        if (window.physical)
+        {
+            // Only the physical view has a time window of its own
+            if (view != VIEW_TIME)
+                continue;
+            static_cast<TraditionalVis *>(vis)->setTimeWindow(window.startTime,
+                                                              window.stopTime);
+            label = QString("time %1:%2").arg(window.startTime)
+                    .arg(window.stopTime);
+        }
+        else
+        {
+            vis->setSteps(window.startStep, window.stopStep, true);
+            label = QString("steps %1:%2").arg(window.startStep)
+                    .arg(window.stopStep);
+        }
+
+        QPainter painter(&image);
+        vis->paintOffscreen(&painter);
+        painter.end();
+
+        const FrameStats& stats = vis->getFrameStats();
+        totalTime += stats.totalTime();
+        maxTime = std::max(maxTime, stats.totalTime());
+        ++frames;
+        std::cout << "frame " << i << " (" << label.toStdString().c_str()
+                  << "): " << stats.summary().join(", ").toStdString().c_str()
+                  << std::endl;
+    }
+    delete vis;
+
+    if (!frames)
+    {
+        std::cout << "No replay windows apply to this view." << std::endl;
+        return false;
+    }
+    std::cout << QString("%1 frames, mean %2 ms, max %3 ms")
+                 .arg(frames)
+                 .arg(totalTime * 1e-6 / frames, 0, 'f', 2)
+                 .arg(maxTime * 1e-6, 0, 'f', 2).toStdString().c_str()
+              << std::endl;
+    return true;
+}
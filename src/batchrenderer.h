@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <QObject>
+#include <QString>
+#include <QSize>
+#include <QList>
+
+class Trace;
+class ImportOptions;
+class VisOptions;
+class VisWidget;
+
+// Renders views of a trace straight to image or SVG files without showing
+// any windows, so pictures of many runs can be made from scripts
+class BatchRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    BatchRenderer(ImportOptions * _importoptions, VisOptions * _visoptions);
+    ~BatchRenderer();
+
+    enum ViewType { VIEW_STEP, VIEW_TIME, VIEW_OVERVIEW };
+    static bool viewFromName(QString name, ViewType& view);
+
+    bool loadTrace(QString dataFileName);
+    bool render(ViewType view, QString filename, QSize size);
+
+    // Window to render, the whole trace if not set
+    void setStepWindow(float start, float stop);
+    void setTimeWindow(unsigned long long start, unsigned long long stop);
+
+    // Windows given as <start>:<stop>
+    static bool parseStepWindow(QString text, float& start, float& stop);
+    static bool parseTimeWindow(QString text, unsigned long long& start,
+                                unsigned long long& stop);
+
+    // Scripted view changes for benchmarking. Each line of the script is
+    // "steps <start>:<stop>" or "time <start>:<stop>", blank lines and
+    // lines starting with # are skipped.
+    bool loadReplay(QString filename);
+    bool replay(ViewType view, QSize size);
+
+public slots:
+    void traceFinished(Trace * _trace);
+
+private:
+    VisWidget * createView(ViewType view);
+    VisWidget * setupView(ViewType view, QSize size);
+
+    // One step in a replay script
+    struct ReplayWindow {
+        bool physical; // time window rather than step window
+        float startStep;
+        float stopStep;
+        unsigned long long startTime;
+        unsigned long long stopTime;
+    };
+
+    ImportOptions * importoptions;
+    VisOptions * visoptions;
+    Trace * trace;
+
+    float startStep;
+    float stopStep; // negative when not set
+    unsigned long long startTime;
+    unsigned long long stopTime; // zero when not set
+
+    QList<ReplayWindow> replayWindows;
+};
+
+#endif // BATCHRENDERER_H
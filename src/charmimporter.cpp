@@ -12,7 +12,13 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QStack>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QThread>
 #include <zlib.h>
+#include <cstring>
+#include <algorithm>
 #include <sstream>
 #include <fstream>
 #include "trace.h"
@@ -26,6 +32,7 @@
 #include "importoptions.h"
 #include "primaryentitygroup.h"
 #include "metrics.h"
+#include "logpipeline.h"
 
 #include "ravelutils.h"
 
@@ -49,13 +56,10 @@ CharmImporter::CharmImporter()
       trace(NULL),
       unmatched_recvs(NULL),
       sends(NULL),
-      charm_stack(new QStack<CharmEvt *>()),
       charm_events(NULL),
-      entity_events(NULL),
-      pe_events(NULL),
       charm_p2ps(NULL),
       pe_p2ps(NULL),
-      idle_to_next(new QMap<Event *, int>()),
+      pe_idles(NULL),
       messages(new QVector<CharmMsg *>()),
       primaries(new QMap<int, PrimaryEntityGroup *>()),
       entitygroups(new QMap<int, EntityGroup *>()),
@@ -65,11 +69,7 @@ CharmImporter::CharmImporter()
       groups(new QMap<int, ChareGroup *>()),
       atomics(new QMap<int, int>()),
       reductions(new QMap<int, QMap<int, int> *>()),
-      chare_to_entity(new QMap<ChareIndex, int>()),
-      last(QStack<CharmEvt *>()),
-      last_evt(NULL),
-      last_entry(NULL),
-      add_order(0),
+      chare_to_entity(new QHash<ChareIndex, int>()),
       idles(QList<Event *>()),
       seen_chares(QSet<QString>()),
       application_chares(QSet<int>()),
@@ -123,8 +123,6 @@ CharmImporter::~CharmImporter()
     }
     delete reductions;
 
-    delete charm_stack;
-    delete idle_to_next;
     delete addContribution;
     delete recvMsg;
     delete atomics;
@@ -138,17 +136,15 @@ void CharmImporter::importCharmLog(QString dataFileName, ImportOptions * _option
     options = _options;
     readSts(dataFileName);
 
-    unmatched_recvs = new QVector<QMap<int, QList<CharmMsg *> *> *>(processes);
-    sends = new QVector<QMap<int, QList<CharmMsg *> *> *>(processes);
+    unmatched_recvs = new MessageTable();
+    sends = new MessageTable();
     charm_events = new QVector<QVector<CharmEvt *> *>(processes);
-    pe_events = new QVector<QVector<Event *> *>(processes);
     pe_p2ps = new QVector<QVector<P2PEvent *> *>(processes);
+    pe_idles = new QVector<QVector<IdleNext> *>(processes);
     for (int i = 0; i < processes; i++) {
-        (*unmatched_recvs)[i] = new QMap<int, QList<CharmMsg *> *>();
-        (*sends)[i] = new QMap<int, QList<CharmMsg *> *>();
         (*charm_events)[i] = new QVector<CharmEvt *>();
-        (*pe_events)[i] = new QVector<Event *>();
         (*pe_p2ps)[i] = new QVector<P2PEvent *>();
+        (*pe_idles)[i] = new QVector<IdleNext>();
     }
 
     processDefinitions();
@@ -167,12 +163,41 @@ void CharmImporter::importCharmLog(QString dataFileName, ImportOptions * _option
         gzflag = true;
         suffix += ".gz";
     }
+    QElapsedTimer readTimer;
+    readTimer.start();
+
+    // Inflating and parsing overlap, both within a log and across logs
+    int budget_blocks = qint64(options->charmReadBudget) * (1 << 20)
+                        / log_block_size;
+    LogBlockPool pool(std::max(budget_blocks, 1), log_block_size);
+    QThreadPool inflaters;
+    inflaters.setMaxThreadCount(QThread::idealThreadCount());
+
+    QVector<PELog *> * logs = new QVector<PELog *>(processes);
     for (int i = 0; i < processes; i++)
     {
-        charm_stack->clear();
-        readLog(path + "/" + basename + "." + QString::number(i) + suffix,
-                gzflag, i);
+        (*logs)[i] = new PELog(i, path + "/" + basename + "."
+                                  + QString::number(i) + suffix,
+                               gzflag, charm_events->at(i));
+    }
+    QtConcurrent::blockingMap(*logs, ReadPELog(this, &pool, &inflaters));
+    inflaters.waitForDone();
+
+    // Cross-PE matching and merging of what was gathered per PE
+    mergeLogs(logs);
+    for (QVector<PELog *>::Iterator log = logs->begin();
+         log != logs->end(); ++log)
+    {
+        delete *log;
     }
+    delete logs;
+    RavelUtils::gu_printTime(readTimer.nsecsElapsed(), "Log Read Time: ");
+
+    // Matching is done, the CharmMsgs live on in the CharmEvts
+    delete unmatched_recvs;
+    unmatched_recvs = NULL;
+    delete sends;
+    sends = NULL;
 
     // At this point, I have a list of events per PE
     // Now I have to check to see what chares are actually arrays
@@ -191,12 +216,10 @@ void CharmImporter::importCharmLog(QString dataFileName, ImportOptions * _option
     trace->collective_definitions = new QMap<int, OTFCollective *>();
     trace->collectives = new QMap<unsigned long long, CollectiveRecord *>();
     trace->collectiveMap = new QVector<QMap<unsigned long long, CollectiveRecord *> *>(num_entities);
-    entity_events = new QVector<QVector<CharmEvt *> *>(num_entities);
     charm_p2ps = new QVector<QVector<P2PEvent *> *>(num_entities);
     for (int i = 0; i < num_entities; i++) {
         (*(trace->collectiveMap))[i] = new QMap<unsigned long long, CollectiveRecord *>();
         (*(trace->events))[i] = new QVector<Event *>();
-        (*(entity_events))[i] = new QVector<CharmEvt *>();
         (*(charm_p2ps))[i] = new QVector<P2PEvent *>();
     }
 
@@ -206,6 +229,17 @@ void CharmImporter::importCharmLog(QString dataFileName, ImportOptions * _option
     // Idle calcs
     chargeIdleness();
 
+    // The per-PE comm events were only needed to find idleness
+    for (int i = 0; i < processes; i++)
+    {
+        delete (*pe_p2ps)[i];
+        delete (*pe_idles)[i];
+    }
+    delete pe_p2ps;
+    pe_p2ps = NULL;
+    delete pe_idles;
+    pe_idles = NULL;
+
     // Build partitions
     QElapsedTimer partTimer;
     partTimer.start();
@@ -236,41 +270,10 @@ void CharmImporter::importCharmLog(QString dataFileName, ImportOptions * _option
 
 void CharmImporter::cleanUp()
 {
-    for (QVector<QMap<int, QList<CharmMsg *> *> *>::Iterator itr
-         = unmatched_recvs->begin(); itr != unmatched_recvs->end(); ++itr)
-    {
-        for (QMap<int, QList<CharmMsg *> *>::Iterator eitr
-             = (*itr)->begin(); eitr != (*itr)->end(); ++eitr)
-        {
-            // CharmMsgs deleted in charm events;
-            delete *eitr;
-        }
-        delete *itr;
-    }
-    delete unmatched_recvs;
-
-    for (QVector<QMap<int, QList<CharmMsg *> *> *>::Iterator itr
-         = sends->begin(); itr != sends->end(); ++itr)
-    {
-        for (QMap<int, QList<CharmMsg *> *>::Iterator eitr
-             = (*itr)->begin(); eitr != (*itr)->end(); ++eitr)
-        {
-            // CharmMsgs deleted in charm events;
-            delete *eitr;
-        }
-        delete *itr;
-    }
-    delete sends;
-
+    // CharmEvts already deleted as each PE was converted
     for (QVector<QVector<CharmEvt *> *>::Iterator itr
          = charm_events->begin(); itr != charm_events->end(); ++itr)
     {
-        for (QVector<CharmEvt *>::Iterator eitr
-             = (*itr)->begin(); eitr != (*itr)->end(); ++eitr)
-        {
-            delete *eitr;
-            *eitr = NULL;
-        }
         delete *itr;
     }
     delete charm_events;
@@ -282,57 +285,335 @@ void CharmImporter::cleanUp()
         delete *itr;
     }
     delete charm_p2ps;
+}
 
-    for (QVector<QVector<CharmEvt *> *>::Iterator itr
-         = entity_events->begin(); itr != entity_events->end(); ++itr)
+// Functor to read each PE's log in the thread pool
+struct ReadPELog {
+    ReadPELog(CharmImporter * _importer, LogBlockPool * _pool,
+              QThreadPool * _inflaters)
+        : importer(_importer), pool(_pool), inflaters(_inflaters) {}
+    typedef void result_type;
+    void operator()(CharmImporter::PELog * log) const {
+        importer->readLog(log, pool, inflaters);
+    }
+
+    CharmImporter * importer;
+    LogBlockPool * pool;
+    QThreadPool * inflaters;
+};
+
+// Process each log file (per PE). This runs concurrently for different PEs
+// so it only writes to the PELog. zlib reads plain files as they are, so
+// both .log and .log.gz go through the same large-block reader.
+// The file is inflated on the inflaters pool while this thread parses the
+// blocks already inflated. Blocks come from the shared pool, so the memory
+// held across all PEs stays within the read budget.
+void CharmImporter::readLog(PELog * log, LogBlockPool * pool,
+                            QThreadPool * inflaters)
+{
+    gzFile logfile = gzopen(log->filename.toStdString().c_str(), "rb");
+    if (!logfile)
     {
-        // Evts deleted in charm_events
-        delete *itr;
+        std::cout << "Could not open " << log->filename.toStdString().c_str() << std::endl;
+        return;
     }
-    delete entity_events;
+    gzbuffer(logfile, log_block_size);
 
+    LogBlockQueue queue(log_queue_blocks);
+    inflaters->start(new InflateLog(logfile, pool, &queue));
 
-    for (int i = 0; i < processes; i++)
+    LogBlock * block;
+    while ((block = queue.pop()))
     {
-        delete (*pe_events)[i];
-        delete (*pe_p2ps)[i];
+        parseBlock(block->data, block->length, log);
+        pool->release(block);
     }
+    finishBlocks(log);
 
-    delete pe_events;
-    delete pe_p2ps;
+    gzclose(logfile);
 }
 
-// Process each log file (per PE)
-void CharmImporter::readLog(QString logFileName, bool gzipped, int pe)
+// Parse the complete lines in a block of a PE's log. A line cut off by
+// the end of the block is kept until the next block completes it.
+void CharmImporter::parseBlock(const char * data, int length, PELog * log)
 {
-    last.clear();
-    if (gzipped)
+    const char * end = data + length;
+    const char * line = data;
+    const char * newline;
+
+    if (!log->partial.isEmpty())
     {
-        gzFile logfile = gzopen(logFileName.toStdString().c_str(), "r");
-        char * buffer = new char[1024];
-        gzgets(logfile, buffer, 1024); // Skip first line
-        while (gzgets(logfile, buffer, 1024))
-            parseLine(QString::fromUtf8(buffer).simplified(), pe);
+        newline = static_cast<const char *>(memchr(data, '\n', length));
+        if (!newline)
+        {
+            log->partial.append(data, length);
+            return;
+        }
+        log->partial.append(data, newline - data);
+        parseLine(log->partial.constData(),
+                  log->partial.constData() + log->partial.size(), log);
+        log->partial.clear();
+        line = newline + 1;
+    }
+
+    while (line < end
+           && (newline = static_cast<const char *>(memchr(line, '\n', end - line))))
+    {
+        parseLine(line, newline, log);
+        line = newline + 1;
+    }
+
+    if (line < end)
+        log->partial.append(line, end - line);
+}
+
+// Parse a last line without a newline, if any
+void CharmImporter::finishBlocks(PELog * log)
+{
+    if (!log->partial.isEmpty())
+    {
+        parseLine(log->partial.constData(),
+                  log->partial.constData() + log->partial.size(), log);
+        log->partial.clear();
+    }
+}
+
+// Split a log line into its integer fields in place. As with toLong, a
+// field that is not an integer reads as 0.
+void CharmImporter::PELog::tokenize(const char * line, const char * end)
+{
+    num_fields = 0;
+    const char * c = line;
+    while (c < end)
+    {
+        if (*c == ' ' || *c == '\t' || *c == '\r')
+        {
+            ++c;
+            continue;
+        }
+
+        bool negative = (*c == '-');
+        if (negative)
+            ++c;
+        long value = 0;
+        while (c < end && *c >= '0' && *c <= '9')
+        {
+            value = value * 10 + (*c - '0');
+            ++c;
+        }
+        if (c < end && *c != ' ' && *c != '\t' && *c != '\r')
+        {
+            value = 0;
+            while (c < end && *c != ' ' && *c != '\t' && *c != '\r')
+                ++c;
+        }
+
+        if (num_fields == fields.size())
+            fields.resize(2 * num_fields);
+        fields[num_fields] = negative ? -value : value;
+        num_fields++;
+    }
+}
+
+// Combine the per-PE logs in PE order. Message matching and reduction
+// numbering are replayed here in the same order the logs used to be read
+// one after another, so the result does not depend on thread scheduling.
+void CharmImporter::mergeLogs(QVector<PELog *> * logs)
+{
+    for (QVector<PELog *>::Iterator log = logs->begin();
+         log != logs->end(); ++log)
+    {
+        int my_pe = (*log)->pe;
+
+        for (QList<PendingReduction>::Iterator red = (*log)->reductions.begin();
+             red != (*log)->reductions.end(); ++red)
+        {
+            if (!reductions->contains(red->arrayid))
+                reductions->insert(red->arrayid, new QMap<int, int>());
+            if (!reductions->value(red->arrayid)->value(red->event))
+            {
+                reductions->value(red->arrayid)->insert(red->event, reduction_count);
+                reduction_count++;
+            }
+            red->evt->associated_array = reductions->value(red->arrayid)->value(red->event);
+            red->end_evt->associated_array = red->evt->associated_array;
+        }
+
+        // Arrays keep the chare they were first seen with
+        for (QMap<int, ChareArray *>::Iterator array = (*log)->arrays.begin();
+             array != (*log)->arrays.end(); ++array)
+        {
+            if (!arrays->contains(array.key()))
+            {
+                arrays->insert(array.key(), array.value());
+            }
+            else
+            {
+                arrays->value(array.key())->indices->unite(*(array.value()->indices));
+                delete array.value();
+            }
+        }
+        (*log)->arrays.clear();
+
+        for (QSet<int>::Iterator chare = (*log)->groups.begin();
+             chare != (*log)->groups.end(); ++chare)
+        {
+            if (!groups->contains(*chare))
+                groups->insert(*chare, new ChareGroup(*chare));
+            groups->value(*chare)->pes.insert(my_pe);
+        }
+
+        for (QMap<int, QSet<ChareIndex> >::Iterator chare
+             = (*log)->chare_indices.begin();
+             chare != (*log)->chare_indices.end(); ++chare)
+        {
+            chares->value(chare.key())->indices->unite(chare.value());
+        }
+
+        seen_chares.unite((*log)->seen_chares);
+        if ((*log)->traceEnd > traceEnd)
+            traceEnd = (*log)->traceEnd;
+
+        // Receives that found no send are dropped from the events
+        QSet<CharmEvt *> unmatched = QSet<CharmEvt *>();
+        for (QList<PendingMsg>::Iterator msg = (*log)->msgs.begin();
+             msg != (*log)->msgs.end(); ++msg)
+        {
+            if (msg->send)
+            {
+                matchSend(*msg, my_pe);
+            }
+            else if (!matchRecv(*msg, my_pe))
+            {
+                unmatched.insert(msg->evt);
+                unmatched.insert(msg->end_evt);
+            }
+        }
+
+        if (!unmatched.isEmpty())
+        {
+            QVector<CharmEvt *>::Iterator kept = (*log)->events->begin();
+            for (QVector<CharmEvt *>::Iterator evt = (*log)->events->begin();
+                 evt != (*log)->events->end(); ++evt)
+            {
+                if (unmatched.contains(*evt))
+                {
+                    delete *evt;
+                }
+                else
+                {
+                    *kept = *evt;
+                    ++kept;
+                }
+            }
+            (*log)->events->erase(kept, (*log)->events->end());
+        }
+    }
+}
 
-        gzclose(logfile);
+// Look for the recvs of this send -- note this send may actually be a
+// broadcast. If that's the case, we weant to find all matches,
+// process them, and then remove them from the list, and finally
+// insert ourself so that future recvs to this broadcast can find us.
+// If we find nothig, then we just insert ourself.
+void CharmImporter::matchSend(PendingMsg& send, int my_pe)
+{
+    CharmMsg * candidate = unmatched_recvs->takeAll(my_pe, send.event,
+                                                    send.entry);
+    if (candidate) // Found!
+    {
+        for ( ; candidate; candidate = candidate->next_match)
+        {
+            candidate->sendtime = send.time;
+            candidate->send_evt = send.evt;
+            send.evt->charmmsgs->append(candidate);
+        }
     }
     else
     {
-        std::ifstream logfile(logFileName.toStdString().c_str());
-        std::string line;
-        std::getline(logfile, line); // Skip first line
-        while(std::getline(logfile, line))
-            parseLine(QString::fromStdString(line), pe);
+        CharmMsg * msg = new CharmMsg(send.msg_type, send.msg_len, my_pe,
+                                      send.entry, send.event, send.pe);
+        sends->append(msg);
+        messages->append(msg);
+        msg->sendtime = send.time;
+        msg->send_evt = send.evt;
+    }
+}
 
-        logfile.close();
+// Find the send of this recv, or wait for it if it is on a later PE.
+// Returns false if the send should have been seen already but wasn't.
+bool CharmImporter::matchRecv(PendingMsg& recv, int my_pe)
+{
+    CharmMsg * msg = NULL;
+    if (recv.pe > my_pe) // We get send later
+    {
+        msg = new CharmMsg(recv.msg_type, recv.msg_len, recv.pe, recv.entry,
+                           recv.event, my_pe);
+        unmatched_recvs->append(msg);
+        messages->append(msg);
+
+    } else { // Send already exists
+
+        // May be missing some send events due to runtime collection
+        CharmMsg * send_candidate = sends->first(recv.pe, recv.event,
+                                                 recv.entry);
+        if (send_candidate)
+        {
+            // Copy info as needed from the candidate
+            msg = new CharmMsg(recv.msg_type, recv.msg_len, recv.pe,
+                               recv.entry, recv.event, my_pe);
+            messages->append(msg);
+            msg->send_evt = send_candidate->send_evt;
+            msg->sendtime = send_candidate->sendtime;
+            send_candidate->send_evt->charmmsgs->append(msg);
+        }
+    }
+
+    if (!msg)
+    {
+        if (verbose)
+        {
+            std::cout << "NO MSG FOR RECV!!!" << " on pe " << my_pe << " was expecting message from ";
+            std::cout << recv.pe << " with event " << recv.event;
+            std::cout << " for " << chares->value(entries->value(recv.entry)->chare)->name.toStdString().c_str();
+            std::cout << "::" << entries->value(recv.entry)->name.toStdString().c_str();
+            std::cout << " with index " << recv.evt->index.toVerboseString().toStdString().c_str() << std::endl;
+        }
+        return false;
     }
 
+    msg->recvtime = recv.time;
+    msg->recv_evt = recv.evt;
+    recv.evt->charmmsgs->append(msg);
+    return true;
 }
 
+// Functor to convert each PE's events in the thread pool
+struct ConvertPEEvents {
+    ConvertPEEvents(CharmImporter * _importer) : importer(_importer) {}
+    typedef void result_type;
+    void operator()(CharmImporter::PEConversion * conversion) const {
+        importer->makePEEvents(conversion);
+    }
+
+    CharmImporter * importer;
+};
+
+// Functor to sort each entity's P2P events in the thread pool
+struct SortEntityP2Ps {
+    typedef void result_type;
+    void operator()(QVector<P2PEvent *> * event_list) const {
+        qSort(event_list->begin(), event_list->end(), dereferencedLessThan<P2PEvent>);
+    }
+};
+
 // Take CharmEvt tidbits and make Events out of them
-// Will fill the pe_events and the trace->roots
+// Will fill the pe_p2ps and the trace->roots
 // After this is done we will take the trace events and
 // turn them into partitions.
+// The call trees are built from each PE's stream of enters and exits, so
+// PEs are converted in parallel. What the PEs share (charm_p2ps, idles,
+// add_order) is gathered per PE and merged in PE order afterwards.
 void CharmImporter::makeEntityEvents()
 {
 
@@ -347,22 +628,9 @@ void CharmImporter::makeEntityEvents()
     trace->metrics->append(runtime_metric);
     (*(trace->metric_units))[runtime_metric] = RavelUtils::getUnits(trace->units);
 
-
-
-    // Now make the entity event hierarchy with roots and such
-    QStack<CharmEvt *>  * stack = new QStack<CharmEvt *>();
-    int depth, phase;
-    CharmEvt * bgn = NULL;
-    int counter = 0;
-    int atomic = -1;
-
-    bool have_arrays = false;
-    if (arrays->size() > 0)
-        have_arrays = true;
-
     if (verbose)
     {
-        for (QMap<ChareIndex, int>::Iterator map = chare_to_entity->begin();
+        for (QHash<ChareIndex, int>::Iterator map = chare_to_entity->begin();
              map != chare_to_entity->end(); ++map)
         {
             std::cout << map.key().toVerboseString().toStdString().c_str() << " <---> " << map.value() << std::endl;
@@ -374,151 +642,218 @@ void CharmImporter::makeEntityEvents()
         }
     }
 
+    // A message is shared by the PEs of its send and its recv, so make the
+    // trace messages up front rather than by whichever PE gets there first.
+    for (QVector<CharmMsg *>::Iterator cmsg = messages->begin();
+         cmsg != messages->end(); ++cmsg)
+    {
+        if ((*cmsg)->send_evt && (*cmsg)->recv_evt)
+            (*cmsg)->tracemsg = new Message((*cmsg)->sendtime,
+                                            (*cmsg)->recvtime,
+                                            0);
+    }
+
     // Go through each PE separately, creating events and if necessary
     // putting them into charm_p2ps and setting their entities appropriately
-    for (QVector<QVector<CharmEvt *> *>::Iterator event_list = charm_events->begin();
-         event_list != charm_events->end(); ++event_list)
+    QVector<PEConversion *> conversions = QVector<PEConversion *>(processes);
+    for (int i = 0; i < processes; i++)
+        conversions[i] = new PEConversion(i, charm_events->at(i));
+    QtConcurrent::blockingMap(conversions, ConvertPEEvents(this));
+
+    int add_order = 0;
+    for (QVector<PEConversion *>::Iterator conversion = conversions.begin();
+         conversion != conversions.end(); ++conversion)
+    {
+        for (QList<P2PEvent *>::Iterator p2p = (*conversion)->p2ps.begin();
+             p2p != (*conversion)->p2ps.end(); ++p2p)
+        {
+            (*p2p)->add_order = add_order;
+            add_order++;
+            charm_p2ps->at((*p2p)->entity)->append(*p2p);
+        }
+
+        idles.append((*conversion)->idles);
+        pe_idles->at((*conversion)->pe)->swap((*conversion)->idle_to_next);
+
+        delete *conversion;
+    }
+
+    // Messages neither side kept. The CharmMsgs are done with now too.
+    for (QVector<CharmMsg *>::Iterator cmsg = messages->begin();
+         cmsg != messages->end(); ++cmsg)
+    {
+        if ((*cmsg)->tracemsg && !(*cmsg)->tracemsg->sender
+            && !(*cmsg)->tracemsg->receiver)
+        {
+            delete (*cmsg)->tracemsg;
+        }
+        delete *cmsg;
+    }
+    messages->clear();
+    messages->squeeze();
+
+    // Sort chare events in time
+    QtConcurrent::blockingMap(*charm_p2ps, SortEntityP2Ps());
+    unsigned long long num_events = 0;
+    for (QVector<QVector<P2PEvent *> *>::Iterator event_list
+         = charm_p2ps->begin(); event_list != charm_p2ps->end();
+         ++event_list)
     {
-        stack->clear();
-        last_evt = NULL;
-        last_entry = NULL;
-        depth = 0;
-        phase = 0;
-        counter++;
-        for (QVector<CharmEvt *>::Iterator evt = (*event_list)->begin();
-             evt != (*event_list)->end(); ++evt)
+        num_events += (*event_list)->size();
+    }
+    std::cout << "Total P2P events: " << num_events << std::endl;
+}
+
+// Build the call trees of one PE's events. This runs concurrently for
+// different PEs so it only writes to the PE's own lists and conversion.
+void CharmImporter::makePEEvents(PEConversion * conversion)
+{
+    // Now make the entity event hierarchy with roots and such
+    QStack<CharmEvt *>  * stack = new QStack<CharmEvt *>();
+    int depth = 0, phase = 0;
+    CharmEvt * bgn = NULL;
+    int atomic = -1;
+
+    bool have_arrays = false;
+    if (arrays->size() > 0)
+        have_arrays = true;
+
+    for (QVector<CharmEvt *>::Iterator evt = conversion->events->begin();
+         evt != conversion->events->end(); ++evt)
+    {
+        if ((*evt)->enter)
         {
-            if ((*evt)->enter)
+            // Enter is the only place with the true array id so we must
+            // get the entity id here.
+            if (have_arrays)
             {
-                // Enter is the only place with the true array id so we must
-                // get the entity id here.
-                if (have_arrays)
-                {      
-                    if (((*evt)->arrayid == 0 && (!application_chares.contains((*evt)->index.chare)
-                                                 || ((*evt)->index.chare == main && (*evt)->pe != 0)))
-                             || (*evt)->index.chare == -1)
-                    {
-                        (*evt)->entity = -1;
-                    }
-                    else if (!stack->isEmpty()
-                             && (*evt)->index.chare == main
-                             && (*evt)->entry == SEND_FXN
-                             && stack->top()->chare != main)
-                    {
-                        // This is the case where we attributed to main incorrectly since
-                        // a send records its send destination chare rather than its called
-                        // chare.
-                        (*evt)->entity = num_application_entities + (*evt)->pe;
-                    }
-                    else // Should get main if nothing else works
-                    {
-                        (*evt)->entity = chare_to_entity->value((*evt)->index);
-                    }
-                }
-                else
+                if (((*evt)->arrayid == 0 && (!application_chares.contains((*evt)->index.chare)
+                                             || ((*evt)->index.chare == main && (*evt)->pe != 0)))
+                         || (*evt)->index.chare == -1)
                 {
-                    if (chares->value((*evt)->index.chare)->indices->size() <= 1
-                        && !application_chares.contains((*evt)->index.chare))
-                        (*evt)->entity = -1;
-                    else
-                        (*evt)->entity = chare_to_entity->value((*evt)->index);
+                    (*evt)->entity = -1;
                 }
-
-                if ((*evt)->entity == -1) // runtime chare
+                else if (!stack->isEmpty()
+                         && (*evt)->index.chare == main
+                         && (*evt)->entry == SEND_FXN
+                         && stack->top()->chare != main)
                 {
+                    // This is the case where we attributed to main incorrectly since
+                    // a send records its send destination chare rather than its called
+                    // chare.
                     (*evt)->entity = num_application_entities + (*evt)->pe;
                 }
+                else // Should get main if nothing else works
+                {
+                    (*evt)->entity = chare_to_entity->value((*evt)->index);
+                }
+            }
+            else
+            {
+                if (chares->value((*evt)->index.chare)->indices->size() <= 1
+                    && !application_chares.contains((*evt)->index.chare))
+                    (*evt)->entity = -1;
+                else
+                    (*evt)->entity = chare_to_entity->value((*evt)->index);
+            }
+
+            if ((*evt)->entity == -1) // runtime chare
+            {
+                (*evt)->entity = num_application_entities + (*evt)->pe;
+            }
 
-                if (atomics->contains((*evt)->entry))
+            if (atomics->contains((*evt)->entry))
+            {
+                atomic = atomics->value((*evt)->entry);
+
+                // Check to see if we have a previous entry on the same
+                // entity. That may indicate a when clause. Entity events
+                // from other PEs cannot be called by this PE's last event,
+                // so only this PE's are checked.
+                QVector<P2PEvent *>& entity_p2ps = conversion->entity_p2ps[(*evt)->entity];
+                P2PEvent * last_p2p = NULL;
+                if (entity_p2ps.size() > 0)
+                    last_p2p = entity_p2ps.last();
+                Event * prev_evt = conversion->prev_evt;
+                if (last_p2p && prev_evt && prev_evt->entity == (*evt)->entity)
                 {
-                    atomic = atomics->value((*evt)->entry);
-
-                    // Check to see if we have a previous entry on the same
-                    // entity. That may indicate a when clause.
-                    P2PEvent * last_p2p = NULL;
-                    if (charm_p2ps->at((*evt)->entity)->size() > 0)
-                        last_p2p = charm_p2ps->at((*evt)->entity)->last();
-                    Event * prev_evt = NULL;
-                    if (pe_events->at((*evt)->pe)->size() > 0)
-                        prev_evt = pe_events->at((*evt)->pe)->last();
-                    if (last_p2p && prev_evt && prev_evt->entity == (*evt)->entity)
+                    // If these didn't have atomics set in them. We have
+                    // to go through charm_p2ps because we need P2PEvents
+                    int index = entity_p2ps.size() - 1;
+                    while (last_p2p->caller == prev_evt
+                           && last_p2p->atomic < 0)
                     {
-                        // If these didn't have atomics set in them. We have
-                        // to go through charm_p2ps because we need P2PEvents
-                        int index = charm_p2ps->at((*evt)->entity)->size() - 1;
-                        while (last_p2p->caller == prev_evt
-                               && last_p2p->atomic < 0)
-                        {
-                            last_p2p->atomic = atomic;
-                            index--;
-                            if (index < 0)
-                                break;
-                            last_p2p = charm_p2ps->at((*evt)->entity)->at(index);
-                        }
+                        last_p2p->atomic = atomic;
+                        index--;
+                        if (index < 0)
+                            break;
+                        last_p2p = entity_p2ps.at(index);
                     }
-
                 }
 
-                stack->push(*evt);
-                depth++;
-            } // Handle enter stuff
-            else
+            }
+
+            stack->push(*evt);
+            depth++;
+        } // Handle enter stuff
+        else
+        {
+            // In the case we start in the middle
+            if (stack->isEmpty())
+                continue;
+
+            bgn = stack->pop();
+            // We may have stuff on the stack that doesn't match,
+            // in which case we have to search for something that does match.
+            // This is impossible given our current understanding of nesting but
+            // not sure if runtime will upset this.
+            /*while (bgn->entry != (*evt)->entry
+                   || bgn->event != (*evt)->event
+                   || bgn->pe != (*evt)->pe)
             {
-                // In the case we start in the middle
                 if (stack->isEmpty())
-                    continue;
-
-                bgn = stack->pop();
-                // We may have stuff on the stack that doesn't match,
-                // in which case we have to search for something that does match.
-                // This is impossible given our current understanding of nesting but
-                // not sure if runtime will upset this.
-                /*while (bgn->entry != (*evt)->entry
-                       || bgn->event != (*evt)->event
-                       || bgn->pe != (*evt)->pe)
-                {
-                    if (stack->isEmpty())
-                        bgn = NULL;
-                    else
-                        bgn = stack->pop();
-                } */
+                    bgn = NULL;
+                else
+                    bgn = stack->pop();
+            } */
 
-                if (bgn)
-                    depth = makeEntityEventsPop(stack, bgn, (*evt)->time, phase, depth, atomic);
+            if (bgn)
+                depth = makeEntityEventsPop(conversion, stack, bgn, (*evt)->time,
+                                            phase, depth, atomic);
 
-                // Unset atomic
-                if (atomics->contains(bgn->entry))
-                {
-                    atomic = -1;
-                }
-            } // Handle this Event
-        } // Loop Event
+            // Unset atomic
+            if (atomics->contains(bgn->entry))
+            {
+                atomic = -1;
+            }
+        } // Handle this Event
+    } // Loop Event
 
-        // Unfinished begins
-        while (!stack->isEmpty())
-            depth = makeEntityEventsPop(stack, stack->pop(), traceEnd, phase, depth, atomic);
-    } // Loop Event Lists
+    // Unfinished begins
+    while (!stack->isEmpty())
+        depth = makeEntityEventsPop(conversion, stack, stack->pop(), traceEnd,
+                                    phase, depth, atomic);
 
+    delete stack;
 
-    // Sort chare events in time
-    unsigned long long num_events = 0;
-    for (QVector<QVector<P2PEvent *> *>::Iterator event_list
-         = charm_p2ps->begin(); event_list != charm_p2ps->end();
-         ++event_list)
+    // Everything needed from this PE's CharmEvts is in the Events now, so
+    // free them rather than holding every PE's until the end. Sends only
+    // look at their own CharmEvt, so other PEs never reach these.
+    for (QVector<CharmEvt *>::Iterator evt = conversion->events->begin();
+         evt != conversion->events->end(); ++evt)
     {
-        qSort((*event_list)->begin(), (*event_list)->end(), dereferencedLessThan<P2PEvent>);
-        num_events += (*event_list)->size();
+        delete *evt;
     }
-    std::cout << "Total P2P events: " << num_events << std::endl;
-
-    delete stack;
+    conversion->events->clear();
+    conversion->events->squeeze();
 }
 
 
 // When we pop an event from the event stack, we are closing some sort of function.
 // We keep track of extra information, such as message relations, when we do tihs.
-int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bgn,
-                                     long endtime, int phase, int depth, int atomic)
+int CharmImporter::makeEntityEventsPop(PEConversion * conversion,
+                                       QStack<CharmEvt *> * stack, CharmEvt * bgn,
+                                       long endtime, int phase, int depth, int atomic)
 {
     Event * e = NULL;
 
@@ -536,22 +871,11 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
         for (QList<CharmMsg *>::Iterator cmsg = bgn->charmmsgs->begin();
              cmsg != bgn->charmmsgs->end(); ++cmsg)
         {
-            if ((*cmsg)->tracemsg)
-            {
-                msgs->append((*cmsg)->tracemsg);
-            }
-            else if (!(*cmsg)->send_evt || !(*cmsg)->recv_evt) // incomplete, discard
+            if (!(*cmsg)->tracemsg) // incomplete, discard
             {
                continue;
             }
-            else
-            {
-                Message * msg = new Message((*cmsg)->sendtime,
-                                            (*cmsg)->recvtime,
-                                            0);
-                (*cmsg)->tracemsg = msg;
-                msgs->append(msg);
-            }
+            msgs->append((*cmsg)->tracemsg);
 
             if (bgn->entry == SEND_FXN)
             {
@@ -565,10 +889,9 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
                                                              phase,
                                                              msgs);
                     (*cmsg)->tracemsg->sender->is_recv = false;
-                    (*cmsg)->tracemsg->sender->add_order = add_order;
-                    add_order++;
                     (*cmsg)->send_evt->trace_evt = (*cmsg)->tracemsg->sender;
-                    charm_p2ps->at(bgn->entity)->append((*cmsg)->tracemsg->sender);
+                    conversion->p2ps.append((*cmsg)->tracemsg->sender);
+                    conversion->entity_p2ps[bgn->entity].append((*cmsg)->tracemsg->sender);
 
                     e = (*cmsg)->tracemsg->sender;
 
@@ -578,12 +901,12 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
                     (*cmsg)->tracemsg->sender->atomic = atomic;
                     (*cmsg)->tracemsg->sender->matching = bgn->associated_array;
 
-                    if (last_evt)
+                    if (conversion->last_evt)
                     {
-                        (*cmsg)->tracemsg->sender->pe_prev = last_evt;
-                        last_evt->pe_next = (*cmsg)->tracemsg->sender;
+                        (*cmsg)->tracemsg->sender->pe_prev = conversion->last_evt;
+                        conversion->last_evt->pe_next = (*cmsg)->tracemsg->sender;
                     }
-                    last_evt = (*cmsg)->tracemsg->sender;
+                    conversion->last_evt = (*cmsg)->tracemsg->sender;
 
                 }
                 else
@@ -604,9 +927,8 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
                                                            msgs);
 
                 (*cmsg)->tracemsg->receiver->is_recv = true;
-                (*cmsg)->tracemsg->receiver->add_order = add_order;
-                add_order++;
-                charm_p2ps->at(bgn->entity)->append((*cmsg)->tracemsg->receiver);
+                conversion->p2ps.append((*cmsg)->tracemsg->receiver);
+                conversion->entity_p2ps[bgn->entity].append((*cmsg)->tracemsg->receiver);
 
                 e = (*cmsg)->tracemsg->receiver;
                 (*cmsg)->tracemsg->receiver->metrics->addMetric("Idle", 0, 0);
@@ -616,12 +938,12 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
 
                 pe_p2ps->at(bgn->pe)->append((*cmsg)->tracemsg->receiver);
 
-                if (last_evt)
+                if (conversion->last_evt)
                 {
-                    (*cmsg)->tracemsg->receiver->pe_prev = last_evt;
-                    last_evt->pe_next = (*cmsg)->tracemsg->receiver;
+                    (*cmsg)->tracemsg->receiver->pe_prev = conversion->last_evt;
+                    conversion->last_evt->pe_next = (*cmsg)->tracemsg->receiver;
                 }
-                last_evt = (*cmsg)->tracemsg->receiver;
+                conversion->last_evt = (*cmsg)->tracemsg->receiver;
             }
         }
         if (!e) // No messages were recorded with this, skip for now and don't include
@@ -636,30 +958,31 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
         if (bgn->entry == IDLE_FXN)
         {
             // Index of the next comm event after this IDLE
-            idle_to_next->insert(e, pe_p2ps->at(bgn->pe)->size());
+            conversion->idle_to_next.append(IdleNext(e, pe_p2ps->at(bgn->pe)->size()));
         }
         else
         {
-            if (last_entry)
+            if (conversion->last_entry)
             {
-                if (last_entry->function == IDLE_FXN)
+                if (conversion->last_entry->function == IDLE_FXN)
                 {
-                    e->metrics->addMetric(idle_metric, last_entry->exit - last_entry->enter);
+                    e->metrics->addMetric(idle_metric, conversion->last_entry->exit
+                                                       - conversion->last_entry->enter);
                 }
-                e->metrics->addMetric(runtime_metric, e->enter - last_entry->exit);
+                e->metrics->addMetric(runtime_metric, e->enter - conversion->last_entry->exit);
             }
         }
-        last_entry = e;
+        conversion->last_entry = e;
     }
 
     if (trace->functions->value(bgn->entry)->group == 2) // IDLE
-        idles.append(e);
+        conversion->idles.append(e);
 
     depth--;
     e->depth = depth;
     if (depth == 0)
     {
-        (*(trace->roots))[bgn->pe]->append(e);
+        trace->roots->at(bgn->pe)->append(e);
     }
 
     if (e->exit > endtime)
@@ -676,80 +999,109 @@ int CharmImporter::makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bg
         (*child)->caller = e;
     }
 
-    (*pe_events)[bgn->pe]->append(e);
+    conversion->prev_evt = e;
     return depth;
 }
 
 
+// Functor to charge the idleness of each PE in the thread pool
+struct ChargePEIdleness {
+    ChargePEIdleness(CharmImporter * _importer) : importer(_importer) {}
+    typedef void result_type;
+    void operator()(int pe) const {
+        importer->chargePEIdleness(pe);
+    }
+
+    CharmImporter * importer;
+};
+
 // Look through all idle events and check which events after them
 // are triggered by events that occur before them. This is difficult
 // when clocks are not synchronized. This is also difficult because
 // it may occur chainings of happened before relationships.
 // So I guess we need to look at all the happened before relationships
 // for each recv, which there is only one, and see whether there's a sizable gap
+// Each PE's idles only touch that PE's recvs, so PEs are done in parallel.
 void CharmImporter::chargeIdleness()
 {
-    Event * idle_evt = NULL;
-    P2PEvent * comm_evt = NULL;
+    QVector<int> pes = QVector<int>(processes);
+    for (int i = 0; i < processes; i++)
+        pes[i] = i;
+    QtConcurrent::blockingMap(pes, ChargePEIdleness(this));
+}
+
+// Sweep a PE's idles in time order over the PE's comm events. The sender
+// times of each recv are gathered into flat arrays once, so each idle's
+// forward scan does not chase pointers, and each recv's Idle metric is
+// set once at the end. A recv covered by several idles is charged with
+// the latest of them.
+void CharmImporter::chargePEIdleness(int pe)
+{
+    QVector<IdleNext> * pe_idle = pe_idles->at(pe);
+    if (pe_idle->isEmpty())
+        return;
+
+    QVector<P2PEvent *> * comm_evts = pe_p2ps->at(pe);
+    int num_comms = comm_evts->size();
+
+    // Basically if there's required send doesn't take place
+    // until after the idle begins, charge it to that sender.
+    // If we have a caller, we know the send doesn't happen until
+    // the end of the caller, so use that as the true time.
+    QVector<bool> is_recv = QVector<bool>(num_comms, false);
+    QVector<unsigned long long> send_time = QVector<unsigned long long>(num_comms, 0);
+    QVector<unsigned long long> caller_enter = QVector<unsigned long long>(num_comms, 0);
+    QVector<double> idle_time = QVector<double>(num_comms, -1);
     P2PEvent * sender = NULL;
-    int idle_pos = -1;
-    bool flag = false;
+    for (int i = 0; i < num_comms; i++)
+    {
+        P2PEvent * comm_evt = comm_evts->at(i);
+        if (!comm_evt->is_recv) // only makes sense for recvs
+            continue;
+        sender = comm_evt->messages->first()->sender;
+        if (!sender)
+            continue;
+
+        is_recv[i] = true;
+        send_time[i] = sender->enter;
+        if (sender->caller)
+        {
+            send_time[i] = sender->caller->exit;
+            caller_enter[i] = sender->caller->enter;
+        }
+    }
+
     long idle_diff;
-    for (QMap<Event *, int>::Iterator idle = idle_to_next->begin();
-         idle != idle_to_next->end(); ++idle)
+    for (QVector<IdleNext>::Iterator idle = pe_idle->begin();
+         idle != pe_idle->end(); ++idle)
     {
-        idle_evt = idle.key();
-        idle_pos = idle.value();
-        flag = true;
-        while (flag)
+        Event * idle_evt = idle->idle;
+        for (int pos = idle->next; pos < num_comms; pos++)
         {
-            if (idle_pos >= pe_p2ps->at(idle_evt->pe)->size())
-            {
-                flag = false;
+            if (!is_recv[pos])
+                continue;
+
+            // First check if the sender was actually caused by something happening
+            // after the idle. In this case we don't count it at all since it
+            // wasn't contributing to the idle.
+            if (caller_enter[pos] > idle_evt->exit - 1)
                 break;
-            }
-            comm_evt = pe_p2ps->at(idle_evt->pe)->at(idle_pos);
-            if (comm_evt->is_recv) // only makes sense for recvs
-            {
-                // Basically if there's required send doesn't take place
-                // until after the idle begins, charge it to that sender.
-                // If we have a caller, we know the send doesn't happen until
-                // the end of the caller, so use that as the true time.
-                // One we get to an event where the sender doesn't exhibit
-                // this behavior, then we figure the rest of it must be okay
-                // because it was no longer being held up.
-                sender = comm_evt->messages->first()->sender;
-
-                // First check if the sender was actually caused by something happening
-                // after the idle. In this case we don't count it at all since it
-                // wasn't contributing to the idle.
-                if (sender->caller && sender->caller->enter > idle_evt->exit - 1)
-                {
-                    flag = false;
-                }
-                else
-                {
-                    idle_diff = sender->enter - idle_evt->enter;
-                    if (sender->caller)
-                    {
-                        idle_diff = sender->caller->exit - idle_evt->enter;
-                    }
 
-                    if (idle_diff > 0)
-                    {
-                        // Let the recv collect that as well in a different metric
-                        //comm_evt->metrics->setMetric("Idle", idle_diff, 0);
-                        comm_evt->metrics->setMetric("Idle", idle_evt->exit - idle_evt->enter, 0);
-                    }
-                    else
-                    {
-                        flag = false;
-                    }
-                }
-            }
-            idle_pos++;
+            // One we get to an event where the sender doesn't exhibit
+            // this behavior, then we figure the rest of it must be okay
+            // because it was no longer being held up.
+            idle_diff = send_time[pos] - idle_evt->enter;
+            if (idle_diff <= 0)
+                break;
+
+            // Let the recv collect that as well in a different metric
+            idle_time[pos] = idle_evt->exit - idle_evt->enter;
         }
     }
+
+    for (int i = 0; i < num_comms; i++)
+        if (idle_time[i] >= 0)
+            comm_evts->at(i)->metrics->setMetric("Idle", idle_time[i], 0);
 }
 
 // Partitions the Charm++ events
@@ -974,6 +1326,27 @@ int CharmImporter::makeEntities()
     primaries->insert(0, new PrimaryEntityGroup(0, "main"));
     Entity * mainEntity = new Entity(0, "main", primaries->value(0));
     primaries->value(0)->entities->append(mainEntity);
+
+    // Size the entity lookup once for all the indices it will hold
+    int num_indices = 1;
+    if (arrays->size() > 0)
+    {
+        for (QMap<int, ChareArray *>::Iterator array = arrays->begin();
+             array != arrays->end(); ++array)
+        {
+            num_indices += array.value()->indices->size();
+        }
+    }
+    else
+    {
+        for (QMap<int, Chare *>::Iterator chare = chares->begin();
+             chare != chares->end(); ++chare)
+        {
+            num_indices += chare.value()->indices->size();
+        }
+    }
+    chare_to_entity->reserve(num_indices);
+
     chare_to_entity->insert(ChareIndex(main, 0, 0, 0, 0), 0);
     application_chares.insert(main);
     EntityGroup * group = new EntityGroup(0, "all");
@@ -1074,51 +1447,59 @@ int CharmImporter::makeEntities()
 
 
 // Read/store record from a line of a PE's log file
-void CharmImporter::parseLine(QString line, int my_pe)
+void CharmImporter::parseLine(const char * line, const char * end, PELog * log)
 {
-    int index, mtype, entry, event, pe, assoc = -1;
+    // First line of each log is a header
+    if (!log->header_read)
+    {
+        log->header_read = true;
+        return;
+    }
+
+    int index, mtype, entry, event, pe, reduction_array = -1;
+    int my_pe = log->pe;
     int original_array, arrayid = 0;
     ChareIndex id = ChareIndex(-1, 0,0,0,0);
     long time, msglen, sendTime, recvTime, numpes, cpuStart, cpuEnd;
 
-    QStringList lineList = line.split(" ");
-    int rectype = lineList.at(0).toInt();
+    log->tokenize(line, end);
+    int rectype = log->field(0);
     if (rectype == CREATION || rectype == CREATION_BCAST || rectype == CREATION_MULTICAST)
     {
         // We don't handle messages that are not inside something.
-        if (last.isEmpty())
+        if (log->last.isEmpty())
             return;
 
         // Some type of (multi-send)
-        mtype = lineList.at(1).toInt();
-        entry = lineList.at(2).toInt();
-        time = lineList.at(3).toLong();
-        event = lineList.at(4).toInt();
-        pe = lineList.at(5).toInt(); // Should be my pe
+        mtype = log->field(1);
+        entry = log->field(2);
+        time = log->field(3);
+        event = log->field(4);
+        pe = log->field(5); // Should be my pe
         msglen = -1;
         index = 6;
         if (version >= 2.0)
         {
-            msglen = lineList.at(5).toLong();
+            msglen = log->field(5);
             index++;
         }
         if (version >= 5.0)
         {
-            sendTime = lineList.at(index).toLong();
+            sendTime = log->field(index);
             index++;
         }
         if (rectype == CREATION_BCAST || rectype == CREATION_MULTICAST)
         {
-            numpes = lineList.at(index).toInt();
+            numpes = log->field(index);
             index++;
             if (rectype == CREATION_MULTICAST)
             {
                 index += numpes;
             }
         }
-        if (version >= 7.0 && lineList.size() > index)
+        if (version >= 7.0 && log->num_fields > index)
         {
-            arrayid = lineList.at(index).toInt();
+            arrayid = log->field(index);
             index++;
             original_array = arrayid;
 
@@ -1130,29 +1511,21 @@ void CharmImporter::parseLine(QString line, int my_pe)
             }
             else if (chares->value(chare)->name.startsWith("Ck"))
             {
-
-                if (!reductions->contains(arrayid))
-                    reductions->insert(arrayid, new QMap<int, int>());
-                if (!reductions->value(arrayid)->value(event))
-                {
-                    reductions->value(arrayid)->insert(event, reduction_count);
-                    reduction_count++;
-                }
-                assoc = reductions->value(arrayid)->value(event);
-
+                // Numbered in mergeLogs
+                reduction_array = arrayid;
                 arrayid = 0;
             }
-            if (arrayid > 0 && !arrays->contains(arrayid))
+            if (arrayid > 0 && !log->arrays.contains(arrayid))
             {
-                arrays->insert(arrayid,
-                               new ChareArray(arrayid,
-                                              entries->value(entry)->chare));
+                log->arrays.insert(arrayid,
+                                   new ChareArray(arrayid,
+                                                  entries->value(entry)->chare));
             }
         }
 
-        if (!last.isEmpty())
+        if (!log->last.isEmpty())
         {
-            arrayid = last.top()->index.array;
+            arrayid = log->last.top()->index.array;
         }
 
         CharmEvt * evt = new CharmEvt(SEND_FXN, time, my_pe,
@@ -1163,69 +1536,31 @@ void CharmImporter::parseLine(QString line, int my_pe)
         // what last should hold. However, the send may not be meaningful
         // should its recv not exist or go to a not-kept chare, so this needs
         // to be processed later.
-        if (!last.isEmpty())
+        if (!log->last.isEmpty())
         {
-            evt->index = last.top()->index;
+            evt->index = log->last.top()->index;
         }
 
-        evt->associated_array = assoc;
-
-        charm_events->at(my_pe)->append(evt);
+        log->events->append(evt);
 
         CharmEvt * send_end = new CharmEvt(SEND_FXN, time+1, my_pe,
                                            entries->value(entry)->chare, arrayid,
                                            false);
-        charm_events->at(my_pe)->append(send_end);
-        if (!last.isEmpty())
+        log->events->append(send_end);
+        if (!log->last.isEmpty())
         {
-            send_end->index = last.top()->index;
+            send_end->index = log->last.top()->index;
         }
-        send_end->associated_array = assoc;
 
+        if (reduction_array >= 0)
+            log->reductions.append(PendingReduction(reduction_array, event,
+                                                    evt, send_end));
+
+        // Matched with its recvs in mergeLogs
         if (rectype == CREATION)
         {
-            // Look for our message -- note this send may actually be a
-            // broadcast. If that's the case, we weant to find all matches,
-            // process them, and then remove them from the list, and finally
-            // insert ourself so that future recvs to this broadcast can find us.
-            // If we find nothig, then we just insert ourself.
-            CharmMsg * msg = NULL;
-            QList<CharmMsg *> * candidates = unmatched_recvs->at(my_pe)->value(event);
-            QList<CharmMsg *> toremove = QList<CharmMsg *>();
-            if (candidates)
-            {
-                for (QList<CharmMsg *>::Iterator candidate = candidates->begin();
-                     candidate != candidates->end(); ++candidate)
-                {
-                    if ((*candidate)->entry == entry)
-                    {
-                        (*candidate)->sendtime = time;
-                        (*candidate)->send_evt = evt;
-                        evt->charmmsgs->append(*candidate);
-                        toremove.append(*candidate);
-                    }
-                }
-            }
-
-            if (toremove.size() > 0) // Found!
-            {
-                for (QList<CharmMsg *>::Iterator rmsg = toremove.begin();
-                     rmsg != toremove.end(); ++rmsg)
-                {
-                    candidates->removeOne(*rmsg);
-                }
-            }
-            else
-            {
-                msg = new CharmMsg(mtype, msglen, my_pe, entry, event, pe);
-                if (!sends->at(my_pe)->contains(event))
-                {
-                    sends->at(my_pe)->insert(event, new QList<CharmMsg *>());
-                }
-                sends->at(my_pe)->value(event)->append(msg);
-                msg->sendtime = time;
-                msg->send_evt = evt;
-            }
+            log->msgs.append(PendingMsg(true, mtype, msglen, pe, entry, event,
+                                        time, evt, send_end));
         }
         else if (verbose) // True CREATION_BCAST / CREATION_MULTICAST -- Not yet seen, therefore unhandled
         {
@@ -1233,22 +1568,22 @@ void CharmImporter::parseLine(QString line, int my_pe)
             std::cout << " with event " << event;
             std::cout << " for " << chares->value(entries->value(entry)->chare)->name.toStdString().c_str();
             std::cout << "::" << entries->value(entry)->name.toStdString().c_str();
-            if (!last.isEmpty())
-                std::cout << " with index " << last.top()->index.toVerboseString().toStdString().c_str();
+            if (!log->last.isEmpty())
+                std::cout << " with index " << log->last.top()->index.toVerboseString().toStdString().c_str();
             std::cout << " at " << time << std::endl;
         }
 
-        if (time > traceEnd)
-            traceEnd = time;
+        if (time > log->traceEnd)
+            log->traceEnd = time;
     }
     else if (rectype == BEGIN_PROCESSING)
     {
         // A receive immediately followed by a function
-        mtype = lineList.at(1).toInt();
-        entry = lineList.at(2).toInt();
-        time = lineList.at(3).toLong();
-        event = lineList.at(4).toInt();
-        pe = lineList.at(5).toInt(); // Should be the senders pe
+        mtype = log->field(1);
+        entry = log->field(2);
+        time = log->field(3);
+        event = log->field(4);
+        pe = log->field(5); // Should be the senders pe
         index = 6;
         msglen = -1;
         if (entries->value(entry)->name.startsWith("start_compute"))
@@ -1256,27 +1591,27 @@ void CharmImporter::parseLine(QString line, int my_pe)
 
         if (version >= 2.0)
         {
-            msglen = lineList.at(index).toLong();
+            msglen = log->field(index);
             index++;
         }
         if (version >= 4.0)
         {
-            recvTime = lineList.at(index).toLong();
+            recvTime = log->field(index);
             index++;
             for (int i = 0; i < 3; i++)
             {
-                id.index[i] = lineList.at(index).toInt();
+                id.index[i] = log->field(index);
                 index++;
             }
         }
         if (version >= 7.0)
         {
-            id.index[3] = lineList.at(index).toInt();
+            id.index[3] = log->field(index);
             index++;
         }
         if (version >= 6.5)
         {
-            cpuStart = lineList.at(index).toLong();
+            cpuStart = log->field(index);
             index++;
         }
         if (version >= 6.6)
@@ -1286,9 +1621,9 @@ void CharmImporter::parseLine(QString line, int my_pe)
                 for (int j = 0; j < numPAPI; j++)
                     index++;
         }
-        if (version >= 7.0 && lineList.size() > index)
+        if (version >= 7.0 && log->num_fields > index)
         {
-            arrayid = lineList.at(index).toInt();
+            arrayid = log->field(index);
             index++;
             original_array = arrayid;
 
@@ -1301,51 +1636,40 @@ void CharmImporter::parseLine(QString line, int my_pe)
             }
             else if (chares->value(chare)->name.startsWith("Ck"))
             {
-
-                if (!reductions->contains(arrayid))
-                    reductions->insert(arrayid, new QMap<int, int>());
-                if (!reductions->value(arrayid)->value(event))
-                {
-                    reductions->value(arrayid)->insert(event, reduction_count);
-                    reduction_count++;
-                }
-                assoc = reductions->value(arrayid)->value(event);
-
+                // Numbered in mergeLogs
+                reduction_array = arrayid;
                 arrayid = 0;
             }
 
             if (arrayid > 0)
             {
-                if (!arrays->contains(arrayid))
-                    arrays->insert(arrayid,
-                                   new ChareArray(arrayid,
-                                                  entries->value(entry)->chare));
+                if (!log->arrays.contains(arrayid))
+                    log->arrays.insert(arrayid,
+                                       new ChareArray(arrayid,
+                                                      entries->value(entry)->chare));
 
                 id.array = arrayid;
                 id.chare = entries->value(entry)->chare;
-                arrays->value(arrayid)->indices->insert(id);
+                log->arrays.value(arrayid)->indices->insert(id);
             }
             else
             {
-                if (!groups->contains(entries->value(entry)->chare))
-                    groups->insert(entries->value(entry)->chare,
-                                   new ChareGroup(entries->value(entry)->chare));
-                groups->value(entries->value(entry)->chare)->pes.insert(my_pe);
+                log->groups.insert(entries->value(entry)->chare);
             }
         }
 
 
         // Close off anything that is missing the end message, that's what
         // Projections does
-        if (!charm_stack->isEmpty())
+        if (!log->charm_stack.isEmpty())
         {
-            CharmEvt * front = charm_stack->pop();
+            CharmEvt * front = log->charm_stack.pop();
             CharmEvt * back = new CharmEvt(front->entry, time, my_pe,
                                            front->chare, front->arrayid,
                                            false);
-            charm_events->at(my_pe)->append(back);
-            if (!last.isEmpty())
-                last.pop();
+            log->events->append(back);
+            if (!log->last.isEmpty())
+                log->last.pop();
         }
 
         CharmEvt * evt = new CharmEvt(entry, time, my_pe,
@@ -1353,105 +1677,60 @@ void CharmImporter::parseLine(QString line, int my_pe)
                                       true);
         id.chare = evt->chare;
         evt->index = id;
-        chares->value(evt->chare)->indices->insert(evt->index);
-        charm_events->at(my_pe)->append(evt);
+        log->chare_indices[evt->chare].insert(evt->index);
+        log->events->append(evt);
 
-        seen_chares.insert(chares->value(entries->value(entry)->chare)->name
-                            + "::" + entries->value(entry)->name);
+        log->seen_chares.insert(chares->value(entries->value(entry)->chare)->name
+                                + "::" + entries->value(entry)->name);
 
-        last.push(evt);
+        log->last.push(evt);
 
-        charm_stack->push(evt);
+        log->charm_stack.push(evt);
 
-        CharmMsg * msg = NULL;
-        if (pe > my_pe) // We get send later
-        {
-            msg = new CharmMsg(mtype, msglen, pe, entry, event, my_pe);
-            if (!unmatched_recvs->at(pe)->contains(event))
-            {
-                unmatched_recvs->at(pe)->insert(event, new QList<CharmMsg *>());
-            }
-            unmatched_recvs->at(pe)->value(event)->append(msg);
-            messages->append(msg);
-
-        } else { // Send already exists
-
-            QList<CharmMsg *> * candidates = sends->at(pe)->value(event);
-            CharmMsg * send_candidate = NULL;
-            if (candidates) // May be missing some send events due to runtime collection
-            {
-                for (QList<CharmMsg *>::Iterator candidate = candidates->begin();
-                     candidate != candidates->end(); ++candidate)
-                {
-                    if ((*candidate)->entry == entry)
-                    {
-                        send_candidate = *candidate;
-                        break;
-                    }
-                }
-            }
-            if (send_candidate)
-            {
-                // Copy info as needed from the candidate
-                msg = new CharmMsg(mtype, msglen, pe, entry, event, my_pe);
-                messages->append(msg);
-                msg->send_evt = send_candidate->send_evt;
-                msg->sendtime = send_candidate->sendtime;
-                send_candidate->send_evt->charmmsgs->append(msg);
-            }
-        }
-        if (msg)
-        {
-            // +1 to make sort properly
-            // Note only the enter needs the message, as that's where we look for it
-            evt = new CharmEvt(RECV_FXN, time, my_pe,
-                               entries->value(entry)->chare, arrayid,
-                               true);
-            evt->index = id;
-            evt->associated_array = assoc;
-            charm_events->at(my_pe)->append(evt);
-
-            CharmEvt * recv_end = new CharmEvt(RECV_FXN, time+1, my_pe,
-                                               entries->value(entry)->chare,
-                                               arrayid, false);
-            recv_end->index = id;
-            recv_end->associated_array = assoc;
-            charm_events->at(my_pe)->append(recv_end);
-
-            msg->recvtime = time;
-            msg->recv_evt = evt;
-            evt->charmmsgs->append(msg);
-        }
-        else if (verbose)
-        {
-            std::cout << "NO MSG FOR RECV!!!" << " on pe " << my_pe << " was expecting message from ";
-            std::cout << pe << " with event " << event;
-            std::cout << " for " << chares->value(entries->value(entry)->chare)->name.toStdString().c_str();
-            std::cout << "::" << entries->value(entry)->name.toStdString().c_str();
-            std::cout << " with index " << id.toVerboseString().toStdString().c_str() << std::endl;
-        }
-
-        if (time > traceEnd)
-            traceEnd = time;
+        // Whether the send of this message exists is only known once all
+        // logs are read, so the recv is always made here and then matched
+        // or dropped in mergeLogs.
+        // +1 to make sort properly
+        // Note only the enter needs the message, as that's where we look for it
+        evt = new CharmEvt(RECV_FXN, time, my_pe,
+                           entries->value(entry)->chare, arrayid,
+                           true);
+        evt->index = id;
+        log->events->append(evt);
+
+        CharmEvt * recv_end = new CharmEvt(RECV_FXN, time+1, my_pe,
+                                           entries->value(entry)->chare,
+                                           arrayid, false);
+        recv_end->index = id;
+        log->events->append(recv_end);
+
+        log->msgs.append(PendingMsg(false, mtype, msglen, pe, entry, event,
+                                    time, evt, recv_end));
+        if (reduction_array >= 0)
+            log->reductions.append(PendingReduction(reduction_array, event,
+                                                    evt, recv_end));
+
+        if (time > log->traceEnd)
+            log->traceEnd = time;
     }
     else if (rectype == END_PROCESSING)
     {
         // End of function
-        mtype = lineList.at(1).toInt();
-        entry = lineList.at(2).toInt();
-        time = lineList.at(3).toLong();
-        event = lineList.at(4).toInt();
-        pe = lineList.at(5).toInt();
+        mtype = log->field(1);
+        entry = log->field(2);
+        time = log->field(3);
+        event = log->field(4);
+        pe = log->field(5);
         index = 6;
         msglen = -1;
         if (version >= 2.0)
         {
-            msglen = lineList.at(index).toLong();
+            msglen = log->field(index);
             index++;
         }
         if (version >= 6.5)
         {
-            cpuEnd = lineList.at(index).toLong();
+            cpuEnd = log->field(index);
             index++;
         }
         if (version >= 6.6)
@@ -1461,74 +1740,74 @@ void CharmImporter::parseLine(QString line, int my_pe)
                 for (int j = 0; j < numPAPI; j++)
                     index++;
         }
-        if (version >= 7.0 && lineList.size() > index)
+        if (version >= 7.0 && log->num_fields > index)
         {
-            arrayid = lineList.at(index).toInt();
+            arrayid = log->field(index);
             index++;
 
-            if (arrayid > 0 && !arrays->contains(arrayid))
+            if (arrayid > 0 && !log->arrays.contains(arrayid))
             {
-                arrays->insert(arrayid,
-                               new ChareArray(arrayid,
-                                              entries->value(entry)->chare));
+                log->arrays.insert(arrayid,
+                                   new ChareArray(arrayid,
+                                                  entries->value(entry)->chare));
             }
         }
 
         CharmEvt * evt = new CharmEvt(entry, time, my_pe,
                                       entries->value(entry)->chare,
                                       arrayid, false);
-        if (!last.isEmpty()) // Last may not exist since we can begin recording at a function end
-            evt->index = last.top()->index;
+        if (!log->last.isEmpty()) // Last may not exist since we can begin recording at a function end
+            evt->index = log->last.top()->index;
         evt->index.chare = entries->value(entry)->chare;
-        charm_events->at(my_pe)->append(evt);
+        log->events->append(evt);
 
-        if (!last.isEmpty())
-            last.pop();
-        if (!charm_stack->isEmpty())
-            charm_stack->pop();
+        if (!log->last.isEmpty())
+            log->last.pop();
+        if (!log->charm_stack.isEmpty())
+            log->charm_stack.pop();
 
-        if (time > traceEnd)
-            traceEnd = time;
+        if (time > log->traceEnd)
+            log->traceEnd = time;
     }
     else if (rectype == BEGIN_IDLE)
     {
         // Beginning of Idleness
-        time = lineList.at(1).toLong();
-        pe = lineList.at(2).toInt();
+        time = log->field(1);
+        pe = log->field(2);
 
         CharmEvt * evt = new CharmEvt(IDLE_FXN, time, pe,
                                       0, 0, true);
 
-        charm_events->at(pe)->append(evt);
+        log->events->append(evt);
 
-        if (!last.isEmpty())
-            last.pop();
+        if (!log->last.isEmpty())
+            log->last.pop();
 
-        if (time > traceEnd)
-            traceEnd = time;
+        if (time > log->traceEnd)
+            log->traceEnd = time;
     }
     else if (rectype == END_IDLE)
     {
         // End of Idleness
-        time = lineList.at(1).toLong();
-        pe = lineList.at(2).toInt();
+        time = log->field(1);
+        pe = log->field(2);
 
         CharmEvt * evt = new CharmEvt(IDLE_FXN, time, pe,
                                       0, 0, false);
 
-        charm_events->at(pe)->append(evt);
+        log->events->append(evt);
 
-        if (!last.isEmpty())
-            last.pop();
+        if (!log->last.isEmpty())
+            log->last.pop();
 
-        if (time > traceEnd)
-            traceEnd = time;
+        if (time > log->traceEnd)
+            log->traceEnd = time;
     }
     else if (rectype == END_TRACE)
     {
-        time = lineList.at(1).toLong();
-        if (time > traceEnd)
-            traceEnd = time;
+        time = log->field(1);
+        if (time > log->traceEnd)
+            log->traceEnd = time;
     }
     else if (rectype == MESSAGE_RECV && verbose) // just in case we ever find one
     {     
@@ -1543,6 +1822,89 @@ void CharmImporter::parseLine(QString line, int my_pe)
 
 }
 
+CharmImporter::MessageTable::MessageTable()
+    : slots(QVector<Slot>(1024)),
+      used(0)
+{
+}
+
+// Slot holding the key, or the empty slot where it would go
+int CharmImporter::MessageTable::find(int pe, int event, int entry) const
+{
+    uint hash = uint(pe) * 0x9E3779B1u;
+    hash ^= uint(event) + 0x7F4A7C15u + (hash << 6) + (hash >> 2);
+    hash ^= uint(entry) + 0x7F4A7C15u + (hash << 6) + (hash >> 2);
+
+    int mask = slots.size() - 1;
+    int index = hash & mask;
+    const Slot * slot = slots.constData();
+    while (slot[index].occupied
+           && (slot[index].pe != pe || slot[index].event != event
+               || slot[index].entry != entry))
+    {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// Double the table, keeping it at most half full
+void CharmImporter::MessageTable::grow()
+{
+    QVector<Slot> old = slots;
+    slots = QVector<Slot>(2 * old.size());
+    for (QVector<Slot>::Iterator slot = old.begin(); slot != old.end(); ++slot)
+    {
+        if (slot->occupied)
+            slots[find(slot->pe, slot->event, slot->entry)] = *slot;
+    }
+}
+
+void CharmImporter::MessageTable::append(CharmMsg * msg)
+{
+    int index = find(msg->send_pe, msg->event, msg->entry);
+    Slot& slot = slots[index];
+    if (!slot.occupied)
+    {
+        slot.occupied = true;
+        slot.pe = msg->send_pe;
+        slot.event = msg->event;
+        slot.entry = msg->entry;
+        used++;
+    }
+
+    msg->next_match = NULL;
+    if (slot.tail)
+        slot.tail->next_match = msg;
+    else
+        slot.head = msg;
+    slot.tail = msg;
+
+    if (2 * used > slots.size())
+        grow();
+}
+
+// Oldest message with this key, or NULL
+CharmImporter::CharmMsg * CharmImporter::MessageTable::first(int pe, int event,
+                                                             int entry) const
+{
+    return slots.at(find(pe, event, entry)).head;
+}
+
+// Remove and return the chain of messages with this key. The slot stays
+// occupied so later messages with the key find it again.
+CharmImporter::CharmMsg * CharmImporter::MessageTable::takeAll(int pe, int event,
+                                                               int entry)
+{
+    int index = find(pe, event, entry);
+    if (!slots.at(index).occupied)
+        return NULL;
+    Slot& slot = slots[index];
+    CharmMsg * chain = slot.head;
+    slot.head = NULL;
+    slot.tail = NULL;
+    return chain;
+}
+
 // Check if send and recv belong to the same message
 bool CharmImporter::matchingMessages(CharmMsg * send, CharmMsg * recv)
 {
@@ -4,9 +4,12 @@
 #include <QString>
 #include <QMap>
 #include <QSet>
+#include <QHash>
 #include <QLinkedList>
 #include <iostream>
 #include <QStack>
+#include <QByteArray>
+#include <QVector>
 
 class Trace;
 class Entity;
@@ -18,6 +21,8 @@ class Event;
 class P2PEvent;
 class CommEvent;
 class PrimaryEntityGroup;
+class LogBlockPool;
+class QThreadPool;
 
 class Message;
 
@@ -186,6 +191,18 @@ public:
             return str;
         }
 
+        // All fields mixed into 64 bits, for hashing
+        quint64 key() const
+        {
+            quint64 k = quint64(uint(chare)) << 32 | uint(array);
+            for (int i = 0; i < 4; i++)
+            {
+                k ^= uint(index[i]) + 0x9E3779B97F4A7C15ull + (k << 6) + (k >> 2);
+                k *= 0xFF51AFD7ED558CCDull;
+            }
+            return k ^ (k >> 33);
+        }
+
         QString toVerboseString() const
         {
             QString str = "";
@@ -200,17 +217,28 @@ public:
 
 private:
     class CharmEvt;
+    class PELog;
+    class PEConversion;
+    friend struct ReadPELog;
+    friend struct ConvertPEEvents;
+    friend struct ChargePEIdleness;
 
     void readSts(QString dataFileName);
-    void readLog(QString logFileName, bool gzipped, int pe);
-    void parseLine(QString line, int my_pe);
+    void readLog(PELog * log, LogBlockPool * pool, QThreadPool * inflaters);
+    void parseBlock(const char * data, int length, PELog * log);
+    void finishBlocks(PELog * log);
+    void parseLine(const char * line, const char * end, PELog * log);
+    void mergeLogs(QVector<PELog *> * logs);
     void processDefinitions();
     int makeEntities();
     void makeEntityEvents();
-    int makeEntityEventsPop(QStack<CharmEvt *> * stack, CharmEvt * bgn,
+    void makePEEvents(PEConversion * conversion);
+    int makeEntityEventsPop(PEConversion * conversion,
+                            QStack<CharmEvt *> * stack, CharmEvt * bgn,
                             long endtime, int phase, int depth, int atomic);
 
     void chargeIdleness();
+    void chargePEIdleness(int pe);
 
     void makePartition(QList<P2PEvent *> *events);
     void buildPartitions();
@@ -245,6 +273,7 @@ private:
         ChareArray(int _id, int _chare)
             : id(_id), chare(_chare),
               indices(new QSet<ChareIndex>()) {}
+        ~ChareArray() { delete indices; }
 
         int id;
         int chare;
@@ -271,7 +300,7 @@ private:
             : sendtime(0), recvtime(0), msg_type(_mtype), msg_len(_mlen),
               send_pe(_pe), entry(_entry), event(_event), arrayid(0), recv_pe(_mype),
               send_entity(-1), recv_entity(-1), send_evt(NULL), recv_evt(NULL),
-              tracemsg(NULL) {}
+              tracemsg(NULL), next_match(NULL) {}
 
         unsigned long long sendtime;
         unsigned long long recvtime;
@@ -288,6 +317,40 @@ private:
         CharmEvt * send_evt;
         CharmEvt * recv_evt;
         Message * tracemsg;
+        CharmMsg * next_match; // Chain in a MessageTable
+    };
+
+    // Open-addressed hash table of CharmMsgs keyed on send pe, event and
+    // entry, the fields that identify a message. Messages with the same key
+    // are chained through next_match in the order they were added, so
+    // matching needs neither a list per key nor a scan of candidates.
+    class MessageTable {
+    public:
+        MessageTable();
+
+        void append(CharmMsg * msg);
+        CharmMsg * first(int pe, int event, int entry) const;
+        CharmMsg * takeAll(int pe, int event, int entry);
+
+    private:
+        class Slot {
+        public:
+            Slot() : occupied(false), pe(0), event(0), entry(0),
+                     head(NULL), tail(NULL) {}
+
+            bool occupied;
+            int pe;
+            int event;
+            int entry;
+            CharmMsg * head;
+            CharmMsg * tail;
+        };
+
+        int find(int pe, int event, int entry) const;
+        void grow();
+
+        QVector<Slot> slots; // Size is a power of two
+        int used;
     };
 
 
@@ -362,6 +425,129 @@ private:
 
     };
 
+    // A send or recv seen while reading a PE's log. These are matched
+    // across PEs once all the logs have been read.
+    class PendingMsg {
+    public:
+        PendingMsg(bool _send, int _mtype, long _mlen, int _pe, int _entry,
+                   int _event, unsigned long long _time, CharmEvt * _evt,
+                   CharmEvt * _end)
+            : send(_send), msg_type(_mtype), msg_len(_mlen), pe(_pe),
+              entry(_entry), event(_event), time(_time), evt(_evt),
+              end_evt(_end) {}
+
+        bool send;
+        int msg_type;
+        long msg_len;
+        int pe; // recv pe for sends, send pe for recvs
+        int entry;
+        int event;
+        unsigned long long time;
+        CharmEvt * evt;
+        CharmEvt * end_evt;
+    };
+
+    // A reduction event seen while reading a PE's log. Reductions are
+    // numbered once all the logs have been read.
+    class PendingReduction {
+    public:
+        PendingReduction(int _array, int _event, CharmEvt * _evt,
+                         CharmEvt * _end)
+            : arrayid(_array), event(_event), evt(_evt), end_evt(_end) {}
+
+        int arrayid;
+        int event;
+        CharmEvt * evt;
+        CharmEvt * end_evt;
+    };
+
+    // Everything gathered from a single PE's log. Logs are read in
+    // parallel, so what is shared between PEs is kept here and merged
+    // in PE order afterwards.
+    class PELog {
+    public:
+        PELog(int _pe, QString _filename, bool _gzipped,
+              QVector<CharmEvt *> * _events)
+            : pe(_pe), filename(_filename), gzipped(_gzipped),
+              events(_events), last(QStack<CharmEvt *>()),
+              charm_stack(QStack<CharmEvt *>()),
+              msgs(QList<PendingMsg>()),
+              reductions(QList<PendingReduction>()),
+              arrays(QMap<int, ChareArray *>()), groups(QSet<int>()),
+              chare_indices(QMap<int, QSet<ChareIndex> >()),
+              seen_chares(QSet<QString>()), traceEnd(0),
+              header_read(false), partial(QByteArray()),
+              fields(QVector<long>(64)), num_fields(0) {}
+        ~PELog()
+        {
+            // Arrays not taken by the merge
+            for (QMap<int, ChareArray *>::Iterator itr = arrays.begin();
+                 itr != arrays.end(); ++itr)
+            {
+                delete itr.value();
+            }
+        }
+
+        int pe;
+        QString filename;
+        bool gzipped;
+        QVector<CharmEvt *> * events; // Owned by charm_events
+        QStack<CharmEvt *> last;
+        QStack<CharmEvt *> charm_stack;
+        QList<PendingMsg> msgs;
+        QList<PendingReduction> reductions;
+        QMap<int, ChareArray *> arrays;
+        QSet<int> groups;
+        QMap<int, QSet<ChareIndex> > chare_indices;
+        QSet<QString> seen_chares;
+        long traceEnd;
+
+        // Read state
+        bool header_read;
+        QByteArray partial; // Line continuing into the next block
+        QVector<long> fields; // Fields of the current line, reused
+        int num_fields;
+
+        void tokenize(const char * line, const char * end);
+        long field(int i) const { return i < num_fields ? fields[i] : 0; }
+    };
+
+    // An idle event and the index in pe_p2ps of the first comm event
+    // after it
+    class IdleNext {
+    public:
+        IdleNext(Event * _idle = NULL, int _next = 0)
+            : idle(_idle), next(_next) {}
+
+        Event * idle;
+        int next;
+    };
+
+    // Per-PE state while turning that PE's CharmEvts into Events. PEs
+    // are converted in parallel, so what would go into structures shared
+    // between PEs is kept here until the merge.
+    class PEConversion {
+    public:
+        PEConversion(int _pe, QVector<CharmEvt *> * _events)
+            : pe(_pe), events(_events), last_evt(NULL), last_entry(NULL),
+              prev_evt(NULL),
+              p2ps(QList<P2PEvent *>()),
+              entity_p2ps(QHash<int, QVector<P2PEvent *> >()),
+              idles(QList<Event *>()), idle_to_next(QVector<IdleNext>()) {}
+
+        int pe;
+        QVector<CharmEvt *> * events;
+        CommEvent * last_evt;
+        Event * last_entry;
+        Event * prev_evt; // Last event made on this PE
+        QList<P2PEvent *> p2ps; // In creation order, for add_order
+        QHash<int, QVector<P2PEvent *> > entity_p2ps; // This PE's only
+        QList<Event *> idles;
+        QVector<IdleNext> idle_to_next;
+    };
+
+    void matchSend(PendingMsg& send, int my_pe);
+    bool matchRecv(PendingMsg& recv, int my_pe);
     bool matchingMessages(CharmMsg * send, CharmMsg * recv);
 
     QMap<int, Chare *> * chares;
@@ -385,15 +571,12 @@ private:
 
     Trace * trace;
 
-    QVector<QMap<int, QList<CharmMsg *> *> *> * unmatched_recvs; //[other pe][event]
-    QVector<QMap<int, QList<CharmMsg *> *> *> * sends;
-    QStack<CharmEvt *> * charm_stack;
+    MessageTable * unmatched_recvs; // recvs whose send is on a later pe
+    MessageTable * sends;
     QVector<QVector<CharmEvt *> *> * charm_events;
-    QVector<QVector<CharmEvt *> *> * entity_events;
-    QVector<QVector<Event *> *> * pe_events;
     QVector<QVector<P2PEvent *> *> * charm_p2ps;
     QVector<QVector<P2PEvent *> *> * pe_p2ps;
-    QMap<Event *, int> * idle_to_next;
+    QVector<QVector<IdleNext> *> * pe_idles; // Per PE, in time order
     QVector<CharmMsg *> * messages;
     QMap<int, PrimaryEntityGroup *> * primaries;
     QMap<int, EntityGroup *> * entitygroups;
@@ -403,11 +586,7 @@ private:
     QMap<int, ChareGroup *> * groups;
     QMap<int, int> * atomics; // Map EntryID to Atomic Number
     QMap<int, QMap<int, int> *> * reductions; // ArrayID -> Event -> associated_array;
-    QMap<ChareIndex, int> * chare_to_entity;
-    QStack<CharmEvt *> last;
-    CommEvent * last_evt;
-    Event * last_entry;
-    int add_order;
+    QHash<ChareIndex, int> * chare_to_entity;
 
     QList<Event *> idles;
 
@@ -467,14 +646,17 @@ private:
 
     static const bool verbose = false;
 
+    // Bytes read (and inflated) from a log at a time
+    static const int log_block_size = 1 << 20;
+    // Inflated blocks waiting to be parsed per log
+    static const int log_queue_blocks = 4;
+
 };
 
 inline uint qHash(const CharmImporter::ChareIndex& key)
 {
-    uint myhash = qHash(key.chare) ^ qHash(key.array)
-                  ^ qHash(key.index[3]) ^ qHash(key.index[2])
-                  ^ qHash(key.index[1]) ^ qHash(key.index[0]);
-    return myhash;
+    quint64 k = key.key();
+    return uint(k ^ (k >> 32));
 }
 
 #endif // CHARMIMPORTER_H
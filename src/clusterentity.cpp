@@ -61,27 +61,24 @@ double ClusterEntity::calculateMetricDistance(const ClusterEntity& other) const
 {
     int num_matches = metric_events->size();
     double total_difference = 0;
-    int offset = 0;
     if (metric_events->size() && other.metric_events->size())
     {
+        // Walk the raw arrays, this is the inner loop of all the clustering
+        const long long int * longer = other.metric_events->constData();
+        const long long int * shorter = metric_events->constData();
+        int offset = other.metric_events->size() - metric_events->size();
         if (startStep < other.startStep)
         {
             num_matches = other.metric_events->size();
-            offset = metric_events->size() - other.metric_events->size();
-            for (int i = 0; i < other.metric_events->size(); i++)
-                total_difference += (metric_events->at(offset + i)
-                                    - other.metric_events->at(i))
-                                    * (metric_events->at(offset + i)
-                                    - other.metric_events->at(i));
+            longer = metric_events->constData();
+            shorter = other.metric_events->constData();
+            offset = -offset;
         }
-        else
+        long long int difference;
+        for (int i = 0; i < num_matches; i++)
         {
-            offset = other.metric_events->size() - metric_events->size();
-            for (int i = 0; i < metric_events->size(); i++)
-                total_difference += (other.metric_events->at(offset + i)
-                                    - metric_events->at(i))
-                                    * (other.metric_events->at(offset + i)
-                                    - metric_events->at(i));
+            difference = longer[offset + i] - shorter[i];
+            total_difference += difference * difference;
         }
     }
     if (num_matches <= 0)
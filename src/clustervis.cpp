@@ -29,6 +29,7 @@
 
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QTimer>
 
 #include <cmath>
 
@@ -38,7 +39,8 @@ ClusterVis::ClusterVis(ClusterTreeVis *ctv, QWidget* parent,
       drawnGnomes(QMap<Gnome *, QRect>()),
       selected(NULL),
       treevis(ctv),
-      hover_gnome(NULL)
+      hover_gnome(NULL),
+      reclusterCheckPending(false)
 {
 }
 
@@ -431,7 +433,9 @@ void ClusterVis::paintEvents(QPainter * painter)
     float drawSpan;
     float drawStart;
 
-    // Draw active partitions gnomes
+    // Draw active partitions gnomes. Only these recluster when the metric
+    // changes, the rest wait until they're scrolled into view.
+    bool reclustering = false;
     for (int i = startPartition; i < trace->partitions->length(); ++i)
     {
         part = trace->partitions->at(i);
@@ -439,6 +443,7 @@ void ClusterVis::paintEvents(QPainter * painter)
             break;
         else if (part->max_global_step < bottomStep)
             continue;
+        ++frameStats.clustersVisited;
         if (part->gnome) {
             // The y value here of 0 isn't general... we need another structure
             // to keep track of how much y is used when we're doing the gnome
@@ -457,7 +462,10 @@ void ClusterVis::paintEvents(QPainter * painter)
                                     part->events->size() / 1.0
                                     / trace->num_entities * effectiveHeight);
             part->gnome->drawGnomeQt(painter, gnomeRect, options, blockwidth);
+            ++frameStats.clustersDrawn;
             drawnGnomes[part->gnome] = gnomeRect;
+            if (part->gnome->isReclustering())
+                reclustering = true;
             if (!leftmost)
                 leftmost = part->gnome;
             else if (!nextgnome)
@@ -467,6 +475,13 @@ void ClusterVis::paintEvents(QPainter * painter)
 
     }
 
+    if (reclustering && !reclusterCheckPending)
+    {
+        reclusterCheckPending = true;
+        QTimer::singleShot(reclusterCheckInterval, this,
+                           SLOT(checkReclustering()));
+    }
+
     if (!treevis->getGnome())
     {
         QRect left = drawnGnomes[leftmost];
@@ -499,3 +514,15 @@ void ClusterVis::selectEvent(Event * event, bool aggregate, bool overdraw)
     TimelineVis::selectEvent(event, aggregate, overdraw);
 
 }
+
+// Redraw so gnomes can pick up finished clusterings, the tree too since it
+// may be showing one of them
+void ClusterVis::checkReclustering()
+{
+    reclusterCheckPending = false;
+    if (closed)
+        return;
+
+    update();
+    treevis->update();
+}
@@ -52,6 +52,7 @@ public slots:
     void clusterChanged(); // for cluster selection
     void changeNeighborRadius(int neighbors); // neighborhood radius of top processes
     void selectEvent(Event * event, bool aggregate, bool overdraw);
+    void checkReclustering(); // repaint as background clusterings finish
 
 protected:
     void qtPaint(QPainter *painter);
@@ -65,6 +66,10 @@ protected:
     ClusterTreeVis * treevis;
     Gnome * hover_gnome;
 
+    // Gnomes recluster in the background on metric change, so we poll
+    bool reclusterCheckPending;
+    static const int reclusterCheckInterval = 100; // ms
+
 };
 
 #endif // CLUSTERVIS_H
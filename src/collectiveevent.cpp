@@ -222,7 +222,7 @@ QList<int> CollectiveEvent::neighborEntities()
 }
 
 // We know we have no children, so just do enter/leave as well as the collectives
-void CollectiveEvent::writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap)
+void CollectiveEvent::writeToOTF2(OTF2_EvtWriter * writer, SavedResults * results)
 {
     writeOTF2Enter(writer);
 
@@ -240,5 +240,5 @@ void CollectiveEvent::writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> *
                                     0,
                                     0);
 
-    writeOTF2Leave(writer, attributeMap);
+    writeOTF2Leave(writer, results);
 }
@@ -31,9 +31,12 @@ ColorMap::ColorMap(QColor color, float value, bool _categorical)
       maxValue(1),
       maxClamp(1),
       categorical(_categorical),
-      colors(new QVector<ColorValue *>())
+      colors(new QVector<ColorValue *>()),
+      table(new QVector<QRgb>(table_size)),
+      version(0)
 {
     colors->push_back(new ColorValue(color, value));
+    buildTable();
 }
 
 ColorMap::~ColorMap()
@@ -45,6 +48,7 @@ ColorMap::~ColorMap()
         *itr = NULL;
     }
     delete colors;
+    delete table;
 }
 
 ColorMap::ColorMap(const ColorMap & copy)
@@ -59,6 +63,8 @@ ColorMap::ColorMap(const ColorMap & copy)
     {
         colors->push_back(new ColorValue((*itr)->color, (*itr)->value));
     }
+    table = new QVector<QRgb>(*(copy.table));
+    version = copy.version;
 }
 
 void ColorMap::setRange(double low, double high)
@@ -66,11 +72,13 @@ void ColorMap::setRange(double low, double high)
     minValue = low;
     maxValue = high;
     maxClamp = high;
+    buildTable();
 }
 
 void ColorMap::setClamp(double clamp)
 {
     maxClamp = clamp;
+    buildTable();
 }
 
 void ColorMap::addColor(QColor color, float stop)
@@ -85,11 +93,25 @@ void ColorMap::addColor(QColor color, float stop)
         {
             colors->insert(itr, new ColorValue(color, stop));
             added = true;
+            break;
         }
     }
     if (!added) {
         colors->push_back(new ColorValue(color, stop));
     }
+    buildTable();
+}
+
+// Sample the stops across the normalized range. Categorical maps look up
+// their colors directly so they only bump the version.
+void ColorMap::buildTable()
+{
+    ++version;
+    if (categorical)
+        return;
+
+    for (int i = 0; i < table_size; ++i)
+        (*table)[i] = interpolate(i / double(table_size - 1)).rgba();
 }
 
 QColor ColorMap::color(double value, double opacity)
@@ -98,12 +120,38 @@ QColor ColorMap::color(double value, double opacity)
     if (categorical)
         return categorical_color(value);
 
+    QColor c = QColor::fromRgb(rgb(value));
+    c.setAlpha(opacity*255);
+    return c;
+}
+
+// Opaque color of a value from the table, for callers that keep packed
+// colors around
+QRgb ColorMap::rgb(double value)
+{
+    if (categorical)
+        return categorical_color(value).rgba();
+
+    double span = maxClamp - minValue;
+    if (span <= 0)
+        return table->last();
+
+    double index = (value - minValue) / span * (table_size - 1) + 0.5;
+    if (index < 0)
+        return table->first();
+    else if (!(index < table_size)) // also catches NaN
+        return table->last();
+    return table->at(int(index));
+}
+
+// Blend the stops on either side of a normalized value
+QColor ColorMap::interpolate(double norm_value, double opacity)
+{
     // Find the colors at either end of the given value and blend them them
     ColorValue base1 = ColorValue(QColor(0,0,0,opacity*255), 0);
     ColorValue base2 = ColorValue(QColor(0,0,0,opacity*255), 1);
     ColorValue* low = &base1;
     ColorValue* high = &base2;
-    double norm_value = (value - minValue) / (maxClamp - minValue);
     for (QVector<ColorValue* >::Iterator itr = colors->begin();
          itr != colors->end(); itr++)
     {
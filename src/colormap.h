@@ -36,10 +36,17 @@ public:
     ColorMap(const ColorMap& copy);
     void addColor(QColor color, float stop);
     QColor color(double value, double opacity = 1.0);
+    QRgb rgb(double value);
     void setRange(double low, double high);
     void setClamp(double clamp);
+    double getMin() { return minValue; }
     double getMax() { return maxValue; }
+    double getClamp() { return maxClamp; }
     bool isCategorical() { return categorical; }
+    unsigned long getVersion() { return version; }
+
+    // Entries in the precomputed color table across the clamped range
+    static const int table_size = 1024;
 
 private:
     class ColorValue {
@@ -56,6 +63,8 @@ private:
     QColor average(ColorValue * low, ColorValue * high,
                    double norm, double opacity = 1.0);
     QColor categorical_color(double value);
+    QColor interpolate(double norm, double opacity = 1.0);
+    void buildTable();
 
     // metric value range
     double minValue;
@@ -66,6 +75,12 @@ private:
 
     bool categorical;
     QVector<ColorValue *> * colors;
+
+    // Colors sampled evenly from minValue to maxClamp, rebuilt whenever
+    // the range, clamp or stops change. Version counts the rebuilds so
+    // views can tell when colors they cached are stale.
+    QVector<QRgb> * table;
+    unsigned long version;
 };
 
 #endif // COLORMAP_H
@@ -33,6 +33,7 @@ class CommBundle
 {
 public:
     virtual CommEvent * getDesignee()=0; // Event responsible
+    virtual bool isMessage() { return false; }
     virtual void draw(QPainter * painter, CommDrawInterface * vis)=0;
 };
 
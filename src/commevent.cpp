@@ -23,11 +23,11 @@
 // Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 //////////////////////////////////////////////////////////////////////////////
 #include "commevent.h"
-#include <otf2/OTF2_AttributeList.h>
 #include <otf2/OTF2_GeneralDefinitions.h>
 #include <iostream>
 #include "metrics.h"
 #include "rpartition.h"
+#include "savedresults.h"
 
 CommEvent::CommEvent(unsigned long long _enter, unsigned long long _exit,
                      int _function, int _entity, int _pe, int _phase)
@@ -183,61 +183,21 @@ void CommEvent::calculate_differential_metric(QString metric_name,
                                     getMetric(base_name)- max_parent));
 }
 
-void CommEvent::writeOTF2Leave(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap)
+void CommEvent::writeOTF2Leave(OTF2_EvtWriter * writer, SavedResults * results)
 {
-    // For coalesced steps, don't write attributes
-    if (step < 0)
+    // Phase, step and metrics go to the results columns rather than
+    // the leave. For coalesced steps, there are none.
+    // Rows are filed by the stream being written, not by our entity.
+    if (step >= 0)
     {
-        // Finally write enter event
-        OTF2_EvtWriter_Leave(writer,
-                             NULL,
-                             exit,
-                             function);
-        return;
-    }
-
-    OTF2_AttributeList * attribute_list = OTF2_AttributeList_New();
-
-    // Phase and Step
-    OTF2_AttributeValue phase_value;
-    phase_value.uint32 = phase;
-    OTF2_AttributeList_AddAttribute(attribute_list,
-                                    attributeMap->value("phase"),
-                                    OTF2_TYPE_UINT64,
-                                    phase_value);
-
-    OTF2_AttributeValue step_value;
-    step_value.uint32 = step;
-    OTF2_AttributeList_AddAttribute(attribute_list,
-                                    attributeMap->value("step"),
-                                    OTF2_TYPE_UINT64,
-                                    step_value);
-
-    // Write metrics
-    for (QMap<QString, int>::Iterator attr = attributeMap->begin();
-         attr != attributeMap->end(); ++attr)
-    {
-        if (!metrics->hasMetric(attr.key()))
-            continue;
-
-        OTF2_AttributeValue attr_value;
-        attr_value.uint64 = metrics->getMetric(attr.key());
-        OTF2_AttributeList_AddAttribute(attribute_list,
-                                        attributeMap->value(attr.key()),
-                                        OTF2_TYPE_UINT64,
-                                        attr_value);
-
-        OTF2_AttributeValue agg_value;
-        agg_value.uint64 = metrics->getMetric(attr.key(), true);
-        OTF2_AttributeList_AddAttribute(attribute_list,
-                                        attributeMap->value(attr.key() + "_agg"),
-                                        OTF2_TYPE_UINT64,
-                                        agg_value);
+        OTF2_LocationRef location;
+        OTF2_EvtWriter_GetLocationID(writer, &location);
+        results->append(location, this);
     }
 
     // Finally write enter event
     OTF2_EvtWriter_Leave(writer,
-                         attribute_list,
+                         NULL,
                          exit,
                          function);
 }
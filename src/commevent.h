@@ -152,7 +152,7 @@ public:
     virtual bool isP2P() { return false; }
     virtual bool isReceive() const { return false; }
     virtual bool isCollective() { return false; }
-    virtual void writeOTF2Leave(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap);
+    virtual void writeOTF2Leave(OTF2_EvtWriter * writer, SavedResults * results);
 
     virtual void fixPhases()=0;
     virtual void calculate_differential_metric(QString metric_name,
@@ -34,6 +34,7 @@ class Function;
 class QPainter;
 class CommDrawInterface;
 class Metrics;
+class SavedResults;
 
 class Event
 {
@@ -52,6 +53,10 @@ public:
     {
         return evt1->entity < evt2->entity;
     }
+    static bool eventEnterLessThan(const Event * evt1, const Event * evt2)
+    {
+        return evt1->enter < evt2->enter;
+    }
 
     Event * findChild(unsigned long long time);
     unsigned long long getVisibleEnd(unsigned long long start);
@@ -64,8 +69,8 @@ public:
     virtual bool isCommEvent() { return false; }
     virtual bool isReceive() const { return false; }
     virtual bool isCollective() { return false; }
-    virtual void writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap);
-    virtual void writeOTF2Leave(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap);
+    virtual void writeToOTF2(OTF2_EvtWriter * writer, SavedResults * results);
+    virtual void writeOTF2Leave(OTF2_EvtWriter * writer, SavedResults * results);
     virtual void writeOTF2Enter(OTF2_EvtWriter * writer);
 
     // Call tree info
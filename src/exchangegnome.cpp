@@ -105,6 +105,18 @@ void ExchangeGnome::preprocess()
     Gnome::preprocess();
 }
 
+bool ExchangeGnome::preprocessFromSaved(QDataStream& in)
+{
+    type = findType();
+    if (type != EXCH_SRSR)
+    {
+        SRSRmap.clear();
+        SRSRpatterns.clear();
+    }
+
+    return Gnome::preprocessFromSaved(in);
+}
+
 ExchangeGnome::ExchangeType ExchangeGnome::findType()
 {
     int types[EXCH_UNKNOWN + 1];
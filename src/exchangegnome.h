@@ -42,6 +42,7 @@ public:
     bool detectGnome(Partition * part);
     Gnome * create();
     void preprocess();
+    bool preprocessFromSaved(QDataStream& in);
 
 protected:
     void drawGnomeQtClusterEnd(QPainter * painter, QRect clusterRect,
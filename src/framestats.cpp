@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "framestats.h"
+
+FrameStats::FrameStats()
+    : prepaintTime(0),
+      glTime(0),
+      qtTime(0),
+      eventsVisited(0),
+      eventsDrawn(0),
+      messagesVisited(0),
+      messagesDrawn(0),
+      clustersVisited(0),
+      clustersDrawn(0),
+      cacheHits(0),
+      cacheMisses(0)
+{
+
+}
+
+void FrameStats::reset()
+{
+    prepaintTime = 0;
+    glTime = 0;
+    qtTime = 0;
+    eventsVisited = 0;
+    eventsDrawn = 0;
+    messagesVisited = 0;
+    messagesDrawn = 0;
+    clustersVisited = 0;
+    clustersDrawn = 0;
+    cacheHits = 0;
+    cacheMisses = 0;
+}
+
+// One line per kind of statistic, counts given as drawn / visited
+QStringList FrameStats::summary() const
+{
+    QStringList lines;
+    lines.append(QString("frame %1 ms (prepaint %2, gl %3, qt %4)")
+                 .arg(totalTime() * 1e-6, 0, 'f', 2)
+                 .arg(prepaintTime * 1e-6, 0, 'f', 2)
+                 .arg(glTime * 1e-6, 0, 'f', 2)
+                 .arg(qtTime * 1e-6, 0, 'f', 2));
+    lines.append(QString("events %1 / %2").arg(eventsDrawn)
+                 .arg(eventsVisited));
+    lines.append(QString("messages %1 / %2").arg(messagesDrawn)
+                 .arg(messagesVisited));
+    lines.append(QString("clusters %1 / %2").arg(clustersDrawn)
+                 .arg(clustersVisited));
+    lines.append(QString("cache %1 hit, %2 miss").arg(cacheHits)
+                 .arg(cacheMisses));
+    return lines;
+}
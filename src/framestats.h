@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QtGlobal>
+#include <QStringList>
+
+// Counts and timings gathered while painting one frame of a view. Views
+// count what they visit and what they actually draw so we can tell where
+// a slow frame spends its time.
+class FrameStats
+{
+public:
+    FrameStats();
+    void reset();
+    qint64 totalTime() const { return prepaintTime + glTime + qtTime; }
+    QStringList summary() const;
+
+    // Time spent in each paint phase, in nanoseconds. GL time is only the
+    // time to issue the commands, or the time to draw the same with the
+    // painter when rendering offscreen.
+    qint64 prepaintTime;
+    qint64 glTime;
+    qint64 qtTime;
+
+    int eventsVisited;
+    int eventsDrawn;
+    int messagesVisited;
+    int messagesDrawn;
+    int clustersVisited;
+    int clustersDrawn;
+
+    // Cached geometry or images reused rather than rebuilt
+    int cacheHits;
+    int cacheMisses;
+};
+
+#endif // FRAMESTATS_H
@@ -26,9 +26,12 @@
 #include <QElapsedTimer>
 #include <QLocale>
 #include <QMouseEvent>
+#include <QStack>
+#include <QtConcurrent>
 #include <iostream>
 #include <climits>
 #include <cmath>
+#include <vector>
 #include "kmedoids.h"
 
 #include "p2pevent.h"
@@ -39,14 +42,43 @@
 
 using namespace cluster;
 
+// One independent CLARA repetition for Gnome::findMusters
+class ClaraTrial {
+public:
+    ClaraTrial(unsigned long _seed)
+        : cost(0)
+    {
+        clara.set_seed(_seed);
+        clara.set_max_reps(1);
+    }
+
+    kmedoids clara;
+    double cost;
+};
+
+struct RunClaraTrial {
+    RunClaraTrial(std::vector<ClusterEntity *> * _entities, int _k)
+        : entities(_entities), k(_k) {}
+    typedef void result_type;
+    void operator()(ClaraTrial * trial) const {
+        trial->clara.clara(*entities, Gnome::entity_distance(), k);
+        trial->cost = trial->clara.average_dissimilarity();
+    }
+
+    std::vector<ClusterEntity *> * entities;
+    int k;
+};
+
 Gnome::Gnome()
     : partition(NULL),
       options(NULL),
       seed(0),
+      max_clusters(20),
       mousex(-1),
       mousey(-1),
       metric("Lateness"),
-      cluster_leaves(NULL),
+      clusterings(QMap<QString, Clustering *>()),
+      pending_clusterings(QMap<QString, QFuture<Clustering *> >()),
       cluster_map(NULL),
       cluster_root(NULL),
       max_metric_entity(-1),
@@ -54,9 +86,9 @@ Gnome::Gnome()
       alternation(true),
       neighbors(-1),
       saved_messages(QSet<Message *>()),
-      drawnPCs(QMap<PartitionCluster *, QRect>()),
-      drawnNodes(QMap<PartitionCluster *, QRect>()),
-      drawnEvents(QMap<Event *, QRect>()),
+      drawnPCs(HitGrid<PartitionCluster *>()),
+      drawnNodes(HitGrid<PartitionCluster *>()),
+      drawnEvents(HitGrid<Event *>()),
       selected_pc(NULL),
       is_selected(false),
       hover_event(NULL),
@@ -67,12 +99,37 @@ Gnome::Gnome()
 
 Gnome::~Gnome()
 {
-    if (cluster_root) {
-        cluster_root->delete_tree();
-        delete cluster_root;
-        delete cluster_leaves;
-        delete cluster_map;
+    // Background clusterings read our partition so let them finish first
+    for (QMap<QString, QFuture<Clustering *> >::Iterator job
+         = pending_clusterings.begin();
+         job != pending_clusterings.end(); ++job)
+    {
+        delete job.value().result();
+    }
+    for (QMap<QString, Clustering *>::Iterator clustering
+         = clusterings.begin(); clustering != clusterings.end(); ++clustering)
+    {
+        delete clustering.value();
+    }
+}
+
+Gnome::Clustering::Clustering()
+    : leaves(new QMap<int, PartitionCluster *>()),
+      map(new QMap<int, PartitionCluster *>()),
+      root(NULL),
+      max_metric_entity(-1)
+{
+}
+
+Gnome::Clustering::~Clustering()
+{
+    if (root)
+    {
+        root->delete_tree();
+        delete root;
     }
+    delete leaves;
+    delete map;
 }
 
 bool Gnome::detectGnome(Partition * part)
@@ -87,103 +144,172 @@ Gnome * Gnome::create()
 }
 
 
-// Should be called initially and whenever the metric changes so it can
-// recluster, generate top entities, etc
+// Should be called initially to cluster by the current metric. Metric changes
+// after that go through recluster so they don't block drawing.
 void Gnome::preprocess()
 {
-    if (partition && partition->events->size() > 20)
+    if (!clusterings.contains(metric))
+        clusterings.insert(metric, cluster(metric));
+    useClustering(metric);
+}
+
+// Switch to the clustering for _metric. If we don't have it yet it is built
+// in the background and we keep drawing the current one until it's ready.
+void Gnome::recluster(QString _metric)
+{
+    for (QMap<QString, QFuture<Clustering *> >::Iterator job
+         = pending_clusterings.begin(); job != pending_clusterings.end(); )
     {
-        findMusters();
+        if (job.value().isFinished())
+        {
+            clusterings.insert(job.key(), job.value().result());
+            job = pending_clusterings.erase(job);
+        }
+        else
+        {
+            ++job;
+        }
+    }
+
+    if (_metric == metric)
+        return;
+
+    if (clusterings.contains(_metric))
+        useClustering(_metric);
+    else if (!pending_clusterings.contains(_metric))
+        pending_clusterings.insert(_metric, QtConcurrent::run(this,
+                                                              &Gnome::cluster,
+                                                              _metric));
+}
+
+// Make the cached clustering for _metric the one we draw
+void Gnome::useClustering(QString _metric)
+{
+    Clustering * clustering = clusterings.value(_metric);
+    metric = _metric;
+    cluster_map = clustering->map;
+    cluster_root = clustering->root;
+    max_metric_entity = clustering->max_metric_entity;
+    selected_pc = NULL; // belonged to the old tree
+    generateTopEntities();
+}
+
+// Cluster the entities of the partition by _metric. This only reads the
+// partition so it is safe to run in the background.
+Gnome::Clustering * Gnome::cluster(QString _metric)
+{
+    Clustering * clustering = new Clustering();
+    QVector<ClusterEntity *> * entities
+            = partition->makeClusterEntities(_metric);
+    if (partition->events->size() > max_clusters)
+    {
+        findMusters(clustering, entities, _metric);
         for (QMap<int, PartitionCluster *>::Iterator pc
-             = cluster_leaves->begin(); pc != cluster_leaves->end(); ++pc)
+             = clustering->leaves->begin(); pc != clustering->leaves->end();
+             ++pc)
         {
             (pc.value())->makeClusterVectors();
             for (QList<int>::Iterator member = (pc.value())->members->begin();
                  member != (pc.value())->members->end(); ++member)
             {
-                (*cluster_map)[*member] = pc.value();
+                (*clustering->map)[*member] = pc.value();
             }
         }
-        hierarchicalMusters();
+        hierarchicalMusters(clustering);
     }
     else
     {
-        findClusters();
+        findClusters(clustering, entities, _metric);
     }
-    generateTopEntities();
+
+    for (QVector<ClusterEntity *>::Iterator entity = entities->begin();
+         entity != entities->end(); ++entity)
+    {
+        delete *entity;
+    }
+    delete entities;
+    return clustering;
 }
 
 // Clustering using Muster
-void Gnome::findMusters()
+void Gnome::findMusters(Clustering * clustering,
+                        QVector<ClusterEntity *> * entities, QString _metric)
 {
     QElapsedTimer traceTimer;
     qint64 traceElapsed;
 
     traceTimer.start();
-    top_entities.clear();
-    if (cluster_root)
-    {
-        cluster_root->delete_tree();
-        delete cluster_root;
-        delete cluster_leaves;
-        delete cluster_map;
-    }
     long long int metric, max_metric = LLONG_MIN;
-    max_metric_entity = -1;
-    QString cmetric = "Lateness";
-    if (options)
-        cmetric = options->metric;
-
-    int num_clusters = std::min(20, partition->events->size());
 
-    kmedoids clara;
-    clara.set_seed(seed);
-    clara.clara(partition->cluster_entities->toStdVector(),
-                entity_distance(), num_clusters);
+    int num_clusters = std::min(max_clusters, partition->events->size());
+
+    // CLARA's repetitions are independent, so we run each as its own
+    // single-repetition trial concurrently and keep the cheapest. Trial seeds
+    // derive from ours and ties go to the earliest trial, so the result does
+    // not depend on thread scheduling.
+    std::vector<ClusterEntity *> cluster_entities = entities->toStdVector();
+    QList<ClaraTrial *> trials = QList<ClaraTrial *>();
+    for (int i = 0; i < clara_trials; i++)
+        trials.append(new ClaraTrial(seed + i));
+    QtConcurrent::blockingMap(trials, RunClaraTrial(&cluster_entities,
+                                                    num_clusters));
+
+    int best = 0;
+    for (int i = 1; i < clara_trials; i++)
+        if (trials[i]->cost < trials[best]->cost)
+            best = i;
+    kmedoids& clara = trials[best]->clara;
 
     /* // (Fail to) generate optimal cluster number
     int dim = (partition->max_global_step - partition->min_global_step)/2 + 1;
     std::vector<ClusterEntity> * xvector = new std::vector<ClusterEntity>();
-    for (int i = 0; i < partition->cluster_entities->size(); i++)
-        xvector->push_back(*(partition->cluster_entities->at(i)));
+    for (int i = 0; i < entities->size(); i++)
+        xvector->push_back(*(entities->at(i)));
     clara.xclara(*xvector, entity_distance_np(), num_clusters, dim);
     std::cout << "XClara found " << clara.medoid_ids.size()
               << " clusters" << std::endl;
     */
 
     // Set up clusters structures
-    cluster_leaves = new QMap<int, PartitionCluster *>();
-    cluster_map = new QMap<int, PartitionCluster *>();
     for (int i = 0; i < num_clusters; i++) // TODO: Make cluster_leaves a list
-        cluster_leaves->insert(i,
-                               new PartitionCluster(partition->max_global_step
-                                                    - partition->min_global_step
-                                                    + 2,
-                                                    partition->min_global_step));
+        clustering->leaves->insert(i,
+                                   new PartitionCluster(partition->max_global_step
+                                                        - partition->min_global_step
+                                                        + 2,
+                                                        partition->min_global_step));
     for (int i = 0; i < clara.cluster_ids.size(); i++)
     {
-        int entity = partition->cluster_entities->at(i)->entity;
-        metric = cluster_leaves->value(clara.cluster_ids[i])->addMember(partition->cluster_entities->at(i),
-                                                                        partition->events->value(entity),
-                                                                        cmetric);
+        int entity = entities->at(i)->entity;
+        metric = clustering->leaves->value(clara.cluster_ids[i])->addMember(entities->at(i),
+                                                                            partition->events->value(entity),
+                                                                            _metric);
         if (metric > max_metric)
         {
             max_metric = metric;
-            max_metric_entity = entity;
+            clustering->max_metric_entity = entity;
         }
     }
+
+    for (QList<ClaraTrial *>::Iterator trial = trials.begin();
+         trial != trials.end(); ++trial)
+    {
+        delete *trial;
+    }
+
     traceElapsed = traceTimer.nsecsElapsed();
     RavelUtils::gu_printTime(traceElapsed, "Musterizing: ");
 }
 
 // Once clusters have been determined by muster, do the remaining as hierarchy
 // We do single linkage so we don't calculate much
-void Gnome::hierarchicalMusters()
+void Gnome::hierarchicalMusters(Clustering * clustering)
 {
     QElapsedTimer traceTimer;
     qint64 traceElapsed;
 
     traceTimer.start();
+    QMap<int, PartitionCluster *> * cluster_leaves = clustering->leaves;
+
     // Calculate initial distances
     QList<DistancePair> distances;
 
@@ -200,7 +326,7 @@ void Gnome::hierarchicalMusters()
     qSort(distances); // so we do smallest distance first
 
     // create hierarchy
-    int lastp = distances[0].p1;
+    int lastp = 0;
     PartitionCluster * pc = NULL;
     for (int i = 0; i < distances.size(); i++)
     {
@@ -214,7 +340,7 @@ void Gnome::hierarchicalMusters()
             lastp = current.p1;
         }
     }
-    cluster_root = cluster_leaves->value(lastp)->get_root();
+    clustering->root = cluster_leaves->value(lastp)->get_root();
 
     traceElapsed = traceTimer.nsecsElapsed();
     RavelUtils::gu_printTime(traceElapsed, "Hierarchical mustering: ");
@@ -224,54 +350,202 @@ void Gnome::hierarchicalMusters()
     // and see how it goes
 }
 
+// Restore the clustering from a save rather than recomputing it
+bool Gnome::preprocessFromSaved(QDataStream& in)
+{
+    QString saved_metric;
+    Clustering * clustering = readClusters(in, saved_metric);
+    if (!clustering)
+        return false;
+
+    delete clusterings.value(saved_metric);
+    clusterings.insert(saved_metric, clustering);
+    useClustering(saved_metric);
+    return true;
+}
+
+// Write the cluster tree in post-order so it can be rebuilt by replaying the
+// merges with a stack. Leaves store their members, merges their distance.
+void Gnome::writeClusters(QDataStream& out)
+{
+    out << (cluster_root != NULL);
+    if (!cluster_root)
+        return;
+
+    out << metric << (qint32) max_metric_entity;
+    writeClusterNode(out, cluster_root);
+    out << (qint32) -1;
+}
+
+void Gnome::writeClusterNode(QDataStream& out, PartitionCluster * pc)
+{
+    for (QList<PartitionCluster *>::Iterator child = pc->children->begin();
+         child != pc->children->end(); ++child)
+    {
+        writeClusterNode(out, *child);
+    }
+
+    out << (qint32) pc->children->size();
+    if (pc->children->isEmpty())
+        out << *(pc->members);
+    else
+        out << (qint64) pc->max_distance;
+}
+
+// Rebuild the tree written by writeClusters. Leaves are refilled from the
+// partition's events the same way findMusters/findClusters fill them, and the
+// merges are replayed in their saved order so no distances are computed.
+// Returns NULL if the saved tree does not fit this partition.
+Gnome::Clustering * Gnome::readClusters(QDataStream& in,
+                                        QString& saved_metric)
+{
+    bool has_clusters = false;
+    in >> has_clusters;
+    if (!has_clusters || in.status() != QDataStream::Ok)
+        return NULL;
+
+    qint32 saved_max_entity;
+    in >> saved_metric >> saved_max_entity;
+
+    Clustering * clustering = new Clustering();
+    clustering->max_metric_entity = saved_max_entity;
+
+    // Same choice cluster() makes between Muster and SLINK
+    bool mustered = partition->events->size() > max_clusters;
+
+    QStack<PartitionCluster *> stack = QStack<PartitionCluster *>();
+    bool valid = true;
+    qint32 num_children;
+    while (valid)
+    {
+        in >> num_children;
+        if (in.status() != QDataStream::Ok)
+        {
+            valid = false;
+        }
+        else if (num_children < 0) // end of tree
+        {
+            break;
+        }
+        else if (num_children == 0)
+        {
+            QList<int> members;
+            in >> members;
+            if (!mustered && members.size() != 1)
+                valid = false;
+            for (QList<int>::Iterator member = members.begin();
+                 member != members.end(); ++member)
+            {
+                if (!partition->events->contains(*member)
+                    || clustering->map->contains(*member))
+                {
+                    valid = false;
+                }
+            }
+            if (!valid)
+                break;
+
+            PartitionCluster * pc;
+            if (mustered)
+            {
+                pc = new PartitionCluster(partition->max_global_step
+                                          - partition->min_global_step + 2,
+                                          partition->min_global_step);
+                for (QList<int>::Iterator member = members.begin();
+                     member != members.end(); ++member)
+                {
+                    // addMember only needs the entity id from this
+                    ClusterEntity ce(*member, 0);
+                    pc->addMember(&ce, partition->events->value(*member),
+                                  saved_metric);
+                }
+                pc->makeClusterVectors();
+                clustering->leaves->insert(clustering->leaves->size(), pc);
+            }
+            else
+            {
+                pc = new PartitionCluster(members.first(),
+                                          partition->events->value(members.first()),
+                                          saved_metric);
+                clustering->leaves->insert(members.first(), pc);
+            }
+            for (QList<int>::Iterator member = members.begin();
+                 member != members.end(); ++member)
+            {
+                clustering->map->insert(*member, pc);
+            }
+            stack.push(pc);
+        }
+        else
+        {
+            qint64 distance;
+            in >> distance;
+            if (num_children != 2 || stack.size() < 2)
+            {
+                valid = false;
+                break;
+            }
+            PartitionCluster * c2 = stack.pop();
+            PartitionCluster * c1 = stack.pop();
+            stack.push(new PartitionCluster(distance, c1, c2));
+        }
+    }
+
+    if (!valid || in.status() != QDataStream::Ok || stack.size() != 1
+        || clustering->map->size() != partition->events->size())
+    {
+        while (!stack.isEmpty())
+        {
+            PartitionCluster * pc = stack.pop();
+            pc->delete_tree();
+            delete pc;
+        }
+        delete clustering;
+        return NULL;
+    }
+
+    clustering->root = stack.pop();
+    return clustering;
+}
+
 // Straigth SLINK hierarchy, can take a long time for large #entities or #steps
-void Gnome::findClusters()
+void Gnome::findClusters(Clustering * clustering,
+                         QVector<ClusterEntity *> * entities, QString _metric)
 {
     // Calculate initial distances
     QList<DistancePair> distances;
-    QList<unsigned long> entities = partition->events->keys();
-    top_entities.clear();
-    if (cluster_root)
-    {
-        cluster_root->delete_tree();
-        delete cluster_root;
-        delete cluster_leaves;
-        delete cluster_map;
-    }
+    QMap<int, PartitionCluster *> * cluster_leaves = clustering->leaves;
 
-    // Create PartitionClusters for leaves and create distance list
-    cluster_leaves = new QMap<int, PartitionCluster *>();
-    cluster_map = new QMap<int, PartitionCluster *>();
+    // Create PartitionClusters for leaves and create distance list. The
+    // entities are already in entity order.
     long long int max_metric = LLONG_MIN;
-    max_metric_entity = -1;
-    qSort(entities);
-    int num_entities = entities.size();
+    int num_entities = entities->size();
     int p1, p2;
     long long int distance;
     for (int i = 0; i < num_entities; i++)
     {
-        p1 = entities[i];
+        p1 = entities->at(i)->entity;
         cluster_leaves->insert(p1, new PartitionCluster(p1,
                                                         partition->events->value(p1),
-                                                        "Lateness"));
-        cluster_map->insert(p1, cluster_leaves->value(p1));
+                                                        _metric));
+        clustering->map->insert(p1, cluster_leaves->value(p1));
         if (cluster_leaves->value(p1)->max_metric > max_metric)
         {
             max_metric = cluster_leaves->value(p1)->max_metric;
-            max_metric_entity = p1;
+            clustering->max_metric_entity = p1;
         }
         for (int j = i + 1; j < num_entities; j++)
         {
-            p2 = entities[j];
-            distance = calculateMetricDistance(p1,
-                                               p2);
+            p2 = entities->at(j)->entity;
+            distance = calculateMetricDistance(entities->at(i),
+                                               entities->at(j));
             distances.append(DistancePair(distance, p1, p2));
         }
     }
     qSort(distances); // so we do shortest distance first
 
     // build hierarchy
-    int lastp = distances[0].p1;
+    int lastp = entities->at(0)->entity;
     QList<long long int> cluster_distances = QList<long long int>();
     PartitionCluster * pc = NULL;
     for (int i = 0; i < distances.size(); i++)
@@ -287,7 +561,7 @@ void Gnome::findClusters()
             lastp = current.p1;
         }
     }
-    cluster_root = cluster_leaves->value(lastp)->get_root();
+    clustering->root = cluster_leaves->value(lastp)->get_root();
 
     // From here we could now compress the ClusterEvent metrics (doing the four
     // divides ahead of time) but I'm going to retain the information for now
@@ -297,16 +571,15 @@ void Gnome::findClusters()
 // When calculating distance between two event lists. When one is missing a step,
 // webbestimate the lateness as the step that came before it if available
 // and only if not we skip
-long long int Gnome::calculateMetricDistance(int p1, int p2)
+long long int Gnome::calculateMetricDistance(ClusterEntity * ce1,
+                                             ClusterEntity * ce2)
 {
-    int start1 = partition->cluster_step_starts->value(p1);
-    int start2 = partition->cluster_step_starts->value(p2);
-    QVector<long long int> * events1 = partition->cluster_vectors->value(p1);
-    QVector<long long int> * events2 = partition->cluster_vectors->value(p2);
+    QVector<long long int> * events1 = ce1->metric_events;
+    QVector<long long int> * events2 = ce2->metric_events;
     int num_matches = events1->size();
     long long int total_difference = 0;
     int offset = 0;
-    if (start1 < start2)
+    if (ce1->startStep < ce2->startStep)
     {
         num_matches = events2->size();
         offset = events1->size() - events2->size();
@@ -563,11 +836,8 @@ void Gnome::drawGnomeQt(QPainter * painter, QRect extents,
                         VisOptions *_options, int blockwidth)
 {
     options = _options;
-    if (options->metric != metric)
-    {
-        metric = options->metric;
-        preprocess();
-    }
+    if (options->metric != metric || isReclustering())
+        recluster(options->metric);
     saved_messages.clear();
     drawnPCs.clear();
     drawnNodes.clear();
@@ -803,10 +1073,10 @@ void Gnome::drawGnomeQtTopEntities(QPainter * painter, QRect extents,
                 {
                     painter->drawRect(QRectF(xa, y, wa, h));
                 }
-                drawnEvents[*evt] = QRect(xa, y, (x - xa) + w, h);
+                drawnEvents.insert(*evt, QRect(xa, y, (x - xa) + w, h));
             } else {
                 // For selection
-                drawnEvents[*evt] = QRect(x, y, w, h);
+                drawnEvents.insert(*evt, QRect(x, y, w, h));
             }
 
         }
@@ -978,7 +1248,7 @@ void Gnome::drawTreeBranch(QPainter * painter, QRect current,
 
             QRect node = QRect(my_x - 3, my_y - 3, 6, 6);
             painter->fillRect(node, QBrush(Qt::black));
-            drawnNodes[pc] = node;
+            drawnNodes.insert(pc, node);
 
             drawTreeBranch(painter, QRect(child_x, top_y + used_y,
                                           current.width(), current.height()),
@@ -1047,9 +1317,9 @@ void Gnome::drawGnomeQtClusterBranch(QPainter * painter, QRect current,
                                               barwidth, barheight),
                                partition->events->value(entity), blockwidth,
                                partition->min_global_step);
-        drawnPCs[pc] = QRect(current.x(), current.y(),
-                             current.width(), blockheight);
-        pc->extents = drawnPCs[pc];
+        pc->extents = QRect(current.x(), current.y(),
+                            current.width(), blockheight);
+        drawnPCs.insert(pc, pc->extents);
     }
     else // This is open
     {
@@ -1067,7 +1337,7 @@ void Gnome::drawGnomeQtClusterBranch(QPainter * painter, QRect current,
         drawGnomeQtClusterEnd(painter, clusterRect, pc,
                            barwidth, barheight, blockwidth, blockheight,
                            partition->min_global_step);
-        drawnPCs[pc] = clusterRect;
+        drawnPCs.insert(pc, clusterRect);
         pc->extents = clusterRect;
     }
 
@@ -1145,46 +1415,43 @@ Gnome::ChangeType Gnome::handleDoubleClick(QMouseEvent * event)
     int x = event->x();
     int y = event->y();
     // Find the clicked PartitionCluster
-    for (QMap<PartitionCluster *, QRect>::Iterator p = drawnPCs.begin();
-         p != drawnPCs.end(); ++p)
+    int p = drawnPCs.find(x, y);
+    if (p >= 0)
     {
-        if (p.value().contains(x,y))
+        PartitionCluster * pc = drawnPCs.itemAt(p);
+        if ((Qt::ControlModifier && event->modifiers())
+            && (event->button() == Qt::RightButton))
         {
-            PartitionCluster * pc = p.key();
-            if ((Qt::ControlModifier && event->modifiers())
-                && (event->button() == Qt::RightButton))
-            {
-                // Focus entities on centroid of this cluster
-                options->topByCentroid = true;
-                generateTopEntities(pc);
-                return CHANGE_NONE;
-            }
-            else if (Qt::ControlModifier && event->modifiers())
-            {
-                // Focus entities on max metric
-                options->topByCentroid = false;
-                generateTopEntities(pc);
-                return CHANGE_NONE;
-            }
-            else if (event->button() == Qt::RightButton)
+            // Focus entities on centroid of this cluster
+            options->topByCentroid = true;
+            generateTopEntities(pc);
+            return CHANGE_NONE;
+        }
+        else if (Qt::ControlModifier && event->modifiers())
+        {
+            // Focus entities on max metric
+            options->topByCentroid = false;
+            generateTopEntities(pc);
+            return CHANGE_NONE;
+        }
+        else if (event->button() == Qt::RightButton)
+        {
+            // Select a cluster
+            if (selected_pc == pc)
             {
-                // Select a cluster
-                if (selected_pc == pc)
-                {
-                    selected_pc = NULL;
-                }
-                else
-                {
-                    selected_pc = pc;
-                }
-                return CHANGE_SELECTION;
+                selected_pc = NULL;
             }
-            else if (!pc->children->isEmpty())
+            else
             {
-                // Open a cluster if possible
-                pc->open = true;
-                return CHANGE_CLUSTER;
+                selected_pc = pc;
             }
+            return CHANGE_SELECTION;
+        }
+        else if (!pc->children->isEmpty())
+        {
+            // Open a cluster if possible
+            pc->open = true;
+            return CHANGE_CLUSTER;
         }
     }
 
@@ -1198,16 +1465,9 @@ void Gnome::handleTreeDoubleClick(QMouseEvent * event)
     int y = event->y();
 
     // Figure out which branch this occurs in, open that branch
-    for (QMap<PartitionCluster *, QRect>::Iterator p = drawnNodes.begin();
-         p != drawnNodes.end(); ++p)
-    {
-        if (p.value().contains(x,y))
-        {
-            PartitionCluster * pc = p.key();
-            pc->close();
-            return; // Return so we don't look elsewhere.
-        }
-    }
+    int p = drawnNodes.find(x, y);
+    if (p >= 0)
+        drawnNodes.itemAt(p)->close();
 }
 
 
@@ -1390,40 +1650,32 @@ bool Gnome::handleHover(QMouseEvent * event)
     return false;
     mousex = event->x();
     mousey = event->y();
-    if (options->showAggregateSteps && hover_event
-            && drawnEvents[hover_event].contains(mousex, mousey))
+    int hit = drawnEvents.find(mousex, mousey);
+    Event * evt = (hit >= 0) ? drawnEvents.itemAt(hit) : NULL;
+    if (options->showAggregateSteps && hover_event && evt == hover_event)
     {
         // Need to check if we're changing from aggregate to not or vice versa
-        if (!hover_aggregate && mousex <= drawnEvents[hover_event].x()
+        if (!hover_aggregate && mousex <= drawnEvents.rectAt(hit).x()
                                           + stepwidth)
         {
             hover_aggregate = true;
             return true;
         }
-        else if (hover_aggregate && mousex >=  drawnEvents[hover_event].x()
+        else if (hover_aggregate && mousex >=  drawnEvents.rectAt(hit).x()
                                                + stepwidth)
         {
             hover_aggregate = false;
             return true;
         }
     }
-    else if (hover_event == NULL
-             || !drawnEvents[hover_event].contains(mousex, mousey))
+    else if (hover_event == NULL || evt != hover_event)
     {
         // Finding potential new hover
-        hover_event = NULL;
-        for (QMap<Event *, QRect>::Iterator evt = drawnEvents.begin();
-             evt != drawnEvents.end(); ++evt)
-        {
-            if (evt.value().contains(mousex, mousey))
-            {
-                hover_aggregate = false;
-                if (options->showAggregateSteps && mousex <= evt.value().x()
-                                                             + stepwidth)
-                    hover_aggregate = true;
-                hover_event = evt.key();
-            }
-        }
+        hover_event = evt;
+        hover_aggregate = false;
+        if (evt && options->showAggregateSteps
+            && mousex <= drawnEvents.rectAt(hit).x() + stepwidth)
+            hover_aggregate = true;
 
         return true;
     }
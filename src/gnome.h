@@ -31,8 +31,11 @@
 #include "visoptions.h"
 #include "partitioncluster.h"
 #include "clusterentity.h"
+#include "hitgrid.h"
 #include <QPainter>
 #include <QRect>
+#include <QDataStream>
+#include <QFuture>
 
 class Event;
 class QMouseEvent;
@@ -53,11 +56,17 @@ public:
     virtual bool detectGnome(Partition * part);
     virtual Gnome * create();
     void set_seed(unsigned long s) { seed = s; }
+    void set_max_clusters(int clusters) { max_clusters = clusters; }
     virtual void preprocess();
+    bool isReclustering() { return !pending_clusterings.isEmpty(); }
     void setPartition(Partition * part) { partition = part; }
     void setFunctions(QMap<int, Function *> * _functions)
         { functions = _functions; }
 
+    // Saving/restoring clusterings so they need not be recomputed
+    void writeClusters(QDataStream& out);
+    virtual bool preprocessFromSaved(QDataStream& in);
+
     // Tree GUI
     virtual void drawQtTree(QPainter * painter, QRect extents);
     virtual void setNeighbors(int _neighbors);
@@ -100,10 +109,12 @@ protected:
     QMap<int, Function *> * functions;
     VisOptions * options;
     unsigned long seed;
+    int max_clusters; // CLARA k, at or below this many entities we use SLINK
     int mousex;
     int mousey;
 
     QString metric;
+    static const int clara_trials = 5; // Muster's default repetitions
     class DistancePair {
     public:
         DistancePair(long long _d, int _p1, int _p2)
@@ -134,12 +145,32 @@ protected:
         int step;
     };
 
-    long long int calculateMetricDistance(int p1, int p2);
+    // A complete clustering of the partition by one metric
+    class Clustering {
+    public:
+        Clustering();
+        ~Clustering();
+
+        QMap<int, PartitionCluster *> * leaves;
+        QMap<int, PartitionCluster *> * map; // entity to leaf
+        PartitionCluster * root;
+        int max_metric_entity;
+    };
+
+    long long int calculateMetricDistance(ClusterEntity * ce1,
+                                          ClusterEntity * ce2);
     long long int calculateMetricDistance2(QList<CommEvent *> * list1,
                                            QList<CommEvent *> * list2);
-    void findMusters();
-    void findClusters();
-    void hierarchicalMusters();
+    Clustering * cluster(QString _metric);
+    void findMusters(Clustering * clustering,
+                     QVector<ClusterEntity *> * entities, QString _metric);
+    void findClusters(Clustering * clustering,
+                      QVector<ClusterEntity *> * entities, QString _metric);
+    void hierarchicalMusters(Clustering * clustering);
+    void recluster(QString _metric);
+    void useClustering(QString _metric);
+    Clustering * readClusters(QDataStream& in, QString& saved_metric);
+    void writeClusterNode(QDataStream& out, PartitionCluster * pc);
     virtual void generateTopEntities(PartitionCluster * pc = NULL);
     void generateTopEntitiesWorker(int entity);
     int findCentroidEntity(PartitionCluster * pc);
@@ -157,7 +188,9 @@ protected:
         int nrecvs;
     };
 
-    QMap<int, PartitionCluster * > * cluster_leaves;
+    // Clusterings are kept per metric, the current one is unpacked below
+    QMap<QString, Clustering *> clusterings;
+    QMap<QString, QFuture<Clustering *> > pending_clusterings;
     QMap<int, PartitionCluster * > * cluster_map;
     PartitionCluster * cluster_root;
     int max_metric_entity;
@@ -166,9 +199,9 @@ protected:
     int neighbors; // neighbor radius
 
     QSet<Message *> saved_messages;
-    QMap<PartitionCluster *, QRect> drawnPCs;
-    QMap<PartitionCluster *, QRect> drawnNodes;
-    QMap<Event *, QRect> drawnEvents;
+    HitGrid<PartitionCluster *> drawnPCs;
+    HitGrid<PartitionCluster *> drawnNodes;
+    HitGrid<Event *> drawnEvents;
     PartitionCluster * selected_pc;
     bool is_selected;
     Event * hover_event;
@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef HITGRID_H
+#define HITGRID_H
+
+#include <QVector>
+#include <QRect>
+#include <cmath>
+#include <algorithm>
+
+// Rectangles drawn during a paint and what they show, for finding what is
+// under the pointer. Painting only appends. The first lookup after a paint
+// buckets the rectangles into a uniform grid over their bounds so each
+// lookup only tests the rectangles overlapping one cell.
+template <class T>
+class HitGrid
+{
+public:
+    HitGrid()
+        : items(QVector<T>()), rects(QVector<QRect>()),
+          cell_starts(QVector<int>()), cell_members(QVector<int>()),
+          built(false), bounds(QRect()), columns(0), rows(0),
+          cell_width(1), cell_height(1) {}
+
+    void clear()
+    {
+        items.clear();
+        rects.clear();
+        built = false;
+    }
+
+    void insert(const T& item, const QRect& rect)
+    {
+        items.append(item);
+        rects.append(rect);
+        built = false;
+    }
+
+    int size() const { return items.size(); }
+    bool isEmpty() const { return items.isEmpty(); }
+    const T& itemAt(int i) const { return items.at(i); }
+    const QRect& rectAt(int i) const { return rects.at(i); }
+
+    // Index of the last drawn (so topmost) rectangle containing the point,
+    // or -1 if there is none
+    int find(int x, int y)
+    {
+        if (items.isEmpty())
+            return -1;
+        if (!built)
+            build();
+        if (!bounds.contains(x, y))
+            return -1;
+
+        int cell = cellRow(y) * columns + cellColumn(x);
+        for (int i = cell_starts[cell + 1] - 1; i >= cell_starts[cell]; --i)
+        {
+            int member = cell_members[i];
+            if (rects[member].contains(x, y))
+                return member;
+        }
+        return -1;
+    }
+
+private:
+    int cellColumn(int x) const
+    {
+        return std::min(columns - 1, (x - bounds.x()) / cell_width);
+    }
+    int cellRow(int y) const
+    {
+        return std::min(rows - 1, (y - bounds.y()) / cell_height);
+    }
+
+    // Counting sort of rectangle indices into the cells they overlap, so
+    // each cell's members stay in drawing order
+    void build()
+    {
+        bounds = QRect();
+        for (QVector<QRect>::Iterator rect = rects.begin();
+             rect != rects.end(); ++rect)
+        {
+            if (!rect->isEmpty())
+                bounds = bounds.united(*rect);
+        }
+
+        int side = std::max(1, std::min(max_cells_per_side,
+                                         int(sqrt(double(rects.size())))));
+        columns = side;
+        rows = side;
+        cell_width = std::max(1, (bounds.width() + columns - 1) / columns);
+        cell_height = std::max(1, (bounds.height() + rows - 1) / rows);
+
+        cell_starts = QVector<int>(columns * rows + 1, 0);
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            QVector<int> fill;
+            if (pass == 1)
+            {
+                for (int c = 1; c < cell_starts.size(); ++c)
+                    cell_starts[c] += cell_starts[c - 1];
+                cell_members = QVector<int>(cell_starts.last());
+                fill = cell_starts;
+            }
+
+            for (int i = 0; i < rects.size(); ++i)
+            {
+                const QRect& rect = rects.at(i);
+                if (rect.isEmpty())
+                    continue;
+                int left = cellColumn(rect.left());
+                int right = cellColumn(rect.right());
+                int top = cellRow(rect.top());
+                int bottom = cellRow(rect.bottom());
+                for (int r = top; r <= bottom; ++r)
+                    for (int c = left; c <= right; ++c)
+                    {
+                        if (pass == 0)
+                            cell_starts[r * columns + c + 1]++;
+                        else
+                            cell_members[fill[r * columns + c]++] = i;
+                    }
+            }
+        }
+        built = true;
+    }
+
+    QVector<T> items;
+    QVector<QRect> rects;
+    QVector<int> cell_starts; // offsets into cell_members, one past per cell
+    QVector<int> cell_members;
+    bool built;
+    QRect bounds;
+    int columns;
+    int rows;
+    int cell_width;
+    int cell_height;
+
+    static const int max_cells_per_side = 256;
+};
+
+#endif // HITGRID_H
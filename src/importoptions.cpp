@@ -37,6 +37,8 @@ ImportOptions::ImportOptions(bool _waitall, bool _leap, bool _skip,
       enforceMessageSizes(false),
       seedClusters(false),
       clusterSeed(0),
+      maxClusters(20),
+      charmReadBudget(256),
       advancedStepping(true),
       reorderReceives(false),
       origin(OF_NONE),
@@ -60,9 +62,11 @@ QList<QString> ImportOptions::getOptionNames()
     names.append("option_enforceMessageSizes");
     names.append("option_partitionFunction");
     names.append("option_seedClusters");
-    names.append("option.clusterSeed");
-    names.append("option.advancedStepping");
-    names.append("option.reorderReceives");
+    names.append("option_clusterSeed");
+    names.append("option_maxClusters");
+    names.append("option_charmReadBudget");
+    names.append("option_advancedStepping");
+    names.append("option_reorderReceives");
     return names;
 }
 
@@ -94,9 +98,13 @@ QString ImportOptions::getOptionValue(QString option)
         return seedClusters ? "true" : "";
     else if (option == "option_clusterSeed")
         return QString::number(clusterSeed);
-    else if (option == "option.advancedStepping")
+    else if (option == "option_maxClusters")
+        return QString::number(maxClusters);
+    else if (option == "option_charmReadBudget")
+        return QString::number(charmReadBudget);
+    else if (option == "option_advancedStepping")
         return advancedStepping ? "true" : "";
-    else if (option == "option.reorderReceives")
+    else if (option == "option_reorderReceives")
         return reorderReceives ? "true" : "";
     else
         return "";
@@ -130,6 +138,10 @@ void ImportOptions::setOption(QString option, QString value)
         seedClusters = value.size();
     else if (option == "option_clusterSeed")
         clusterSeed = value.toLong();
+    else if (option == "option_maxClusters")
+        maxClusters = value.toInt();
+    else if (option == "option_charmReadBudget")
+        charmReadBudget = value.toInt();
     else if (option == "option_advancedStepping")
         advancedStepping = value.size();
     else if (option == "option_reorderReceives")
@@ -55,6 +55,8 @@ public:
 
     bool seedClusters; // seed has been set
     long clusterSeed; // random seed for clustering
+    int maxClusters; // most leaf clusters CLARA will find per partition
+    int charmReadBudget; // MB of inflated Charm++ log held while reading
 
     bool advancedStepping; // send structure over receives
     bool reorderReceives; // idealized receive order;
@@ -60,6 +60,8 @@ public slots:
     void onBreakEdit(const QString& text);
     void onCluster(bool cluster);
     void onSeedEdit(const QString& text);
+    void onMaxClusters(int clusters);
+    void onReadBudget(int megabytes);
 
 
 private:
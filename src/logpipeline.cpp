@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "logpipeline.h"
+
+LogBlockPool::LogBlockPool(int count, int block_size)
+    : mutex(),
+      available(),
+      free_blocks(QList<LogBlock *>()),
+      blocks(QList<LogBlock *>())
+{
+    for (int i = 0; i < count; i++)
+        blocks.append(new LogBlock(block_size));
+    free_blocks = blocks;
+}
+
+LogBlockPool::~LogBlockPool()
+{
+    for (QList<LogBlock *>::Iterator block = blocks.begin();
+         block != blocks.end(); ++block)
+    {
+        delete *block;
+    }
+}
+
+LogBlock * LogBlockPool::acquire()
+{
+    QMutexLocker locker(&mutex);
+    while (free_blocks.isEmpty())
+        available.wait(&mutex);
+    return free_blocks.takeLast();
+}
+
+void LogBlockPool::release(LogBlock * block)
+{
+    QMutexLocker locker(&mutex);
+    block->length = 0;
+    free_blocks.append(block);
+    available.wakeOne();
+}
+
+void LogBlockQueue::push(LogBlock * block)
+{
+    QMutexLocker locker(&mutex);
+    while (block && queue.size() >= capacity)
+        not_full.wait(&mutex);
+    queue.enqueue(block);
+    not_empty.wakeOne();
+}
+
+LogBlock * LogBlockQueue::pop()
+{
+    QMutexLocker locker(&mutex);
+    while (queue.isEmpty())
+        not_empty.wait(&mutex);
+    LogBlock * block = queue.dequeue();
+    not_full.wakeOne();
+    return block;
+}
+
+// Inflate until the end of the file, then push the end marker. The file
+// is closed by the parsing side once it sees the marker.
+void InflateLog::run()
+{
+    while (true)
+    {
+        LogBlock * block = pool->acquire();
+        block->length = gzread(logfile, block->data, block->size);
+        if (block->length <= 0)
+        {
+            pool->release(block);
+            break;
+        }
+        queue->push(block);
+    }
+    queue->push(NULL);
+}
@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef LOGPIPELINE_H
+#define LOGPIPELINE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+#include <QRunnable>
+#include <zlib.h>
+
+// A chunk of an inflated log file
+class LogBlock {
+public:
+    LogBlock(int _size) : data(new char[_size]), size(_size), length(0) {}
+    ~LogBlock() { delete[] data; }
+
+    char * data;
+    int size; // capacity of data
+    int length; // bytes filled
+};
+
+// Fixed set of blocks shared by every log being read. Taking a block waits
+// until one is free, which bounds the memory held by inflated log data.
+class LogBlockPool {
+public:
+    LogBlockPool(int count, int block_size);
+    ~LogBlockPool();
+
+    LogBlock * acquire();
+    void release(LogBlock * block);
+
+private:
+    QMutex mutex;
+    QWaitCondition available;
+    QList<LogBlock *> free_blocks;
+    QList<LogBlock *> blocks;
+};
+
+// Blocks of one log in file order, passed from the thread inflating it to
+// the thread parsing it. A NULL block marks the end of the file. Holds at
+// most capacity blocks so one fast inflater cannot take the whole pool.
+class LogBlockQueue {
+public:
+    LogBlockQueue(int _capacity) : capacity(_capacity) {}
+
+    void push(LogBlock * block);
+    LogBlock * pop();
+
+private:
+    int capacity;
+    QMutex mutex;
+    QWaitCondition not_empty;
+    QWaitCondition not_full;
+    QQueue<LogBlock *> queue;
+};
+
+// Inflates an open log into a queue, run on the inflating thread pool
+class InflateLog : public QRunnable {
+public:
+    InflateLog(gzFile _logfile, LogBlockPool * _pool, LogBlockQueue * _queue)
+        : logfile(_logfile), pool(_pool), queue(_queue) {}
+
+    void run();
+
+private:
+    gzFile logfile;
+    LogBlockPool * pool;
+    LogBlockQueue * queue;
+};
+
+#endif // LOGPIPELINE_H
@@ -24,11 +24,142 @@
 //////////////////////////////////////////////////////////////////////////////
 /* Ravel */
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <QFileInfo>
+#include <iostream>
 #include "mainwindow.h"
+#include "batchrenderer.h"
+#include "importoptions.h"
+#include "visoptions.h"
+
+// Render the requested views of the trace to files. With more than one view
+// the view name is added to the file name, e.g. out-step.png. With a replay
+// script each view is also painted once per scripted window for timing.
+static int renderBatch(QCommandLineParser& parser)
+{
+    QStringList traces = parser.positionalArguments();
+    if (traces.size() != 1)
+    {
+        std::cout << "Rendering needs exactly one trace." << std::endl;
+        return 1;
+    }
+
+    QStringList size = parser.value("size").split('x');
+    if (size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0)
+    {
+        std::cout << "Size should be <width>x<height>." << std::endl;
+        return 1;
+    }
+
+    ImportOptions importoptions;
+    importoptions.cluster = false; // no cluster view to draw
+    VisOptions visoptions;
+    BatchRenderer renderer(&importoptions, &visoptions);
+
+    if (parser.isSet("steps"))
+    {
+        float start = 0, stop = 0;
+        if (!BatchRenderer::parseStepWindow(parser.value("steps"), start, stop))
+        {
+            std::cout << "Steps should be <start>:<stop>." << std::endl;
+            return 1;
+        }
+        renderer.setStepWindow(start, stop);
+    }
+    if (parser.isSet("time"))
+    {
+        unsigned long long start = 0, stop = 0;
+        if (!BatchRenderer::parseTimeWindow(parser.value("time"), start, stop))
+        {
+            std::cout << "Time should be <start>:<stop>." << std::endl;
+            return 1;
+        }
+        renderer.setTimeWindow(start, stop);
+    }
+    if (parser.isSet("replay")
+        && !renderer.loadReplay(parser.value("replay")))
+        return 1;
+
+    if (!renderer.loadTrace(traces[0]))
+        return 1;
+
+    QString output = parser.value("render");
+    QStringList views = parser.value("view").split(',');
+    QFileInfo outputInfo(output);
+    BatchRenderer::ViewType view;
+    int failed = 0;
+    for (QStringList::Iterator name = views.begin(); name != views.end();
+         ++name)
+    {
+        if (!BatchRenderer::viewFromName(*name, view))
+        {
+            std::cout << "Unknown view " << name->toStdString().c_str()
+                      << std::endl;
+            failed++;
+            continue;
+        }
+
+        QSize viewSize(size[0].toInt(), size[1].toInt());
+        if (parser.isSet("replay"))
+        {
+            std::cout << "Replaying " << name->toStdString().c_str()
+                      << " view" << std::endl;
+            if (!renderer.replay(view, viewSize))
+                failed++;
+        }
+        if (!parser.isSet("render"))
+            continue;
+
+        QString filename = output;
+        if (views.size() > 1)
+            filename = outputInfo.path() + "/" + outputInfo.completeBaseName()
+                       + "-" + *name + "." + outputInfo.suffix();
+        if (!renderer.render(view, filename, viewSize))
+            failed++;
+    }
+    return failed ? 1 : 0;
+}
 
 int main(int argc, char **argv)
 {
     QApplication app(argc, argv);
+
+    // Without --render we start the GUI as usual. For rendering on machines
+    // without a display, also pass -platform offscreen.
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Ravel trace visualization");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("render",
+                                        "Render views to <file> (.png, .svg, ...) without opening a window.",
+                                        "file"));
+    parser.addOption(QCommandLineOption("view",
+                                        "Comma separated views to render: step, physical, overview.",
+                                        "views", "step"));
+    parser.addOption(QCommandLineOption("size",
+                                        "Rendered size as <width>x<height>.",
+                                        "size", "1600x900"));
+    parser.addOption(QCommandLineOption("steps",
+                                        "Step window to render as <start>:<stop>.",
+                                        "steps"));
+    parser.addOption(QCommandLineOption("time",
+                                        "Time window of the physical view as <start>:<stop>.",
+                                        "time"));
+    parser.addOption(QCommandLineOption("replay",
+                                        "Paint each window of <script> in turn and report the frame statistics. Script lines are steps <start>:<stop> or time <start>:<stop>.",
+                                        "script"));
+    parser.addPositionalArgument("trace", "Trace to render.");
+
+    // The GUI may be handed arguments we don't know (Qt flags, files from
+    // the desktop), so only be strict when rendering or asked for help.
+    parser.parse(app.arguments());
+    if (parser.isSet("render") || parser.isSet("replay")
+        || parser.isSet("help"))
+    {
+        parser.process(app);
+        return renderBatch(parser);
+    }
+
     MainWindow w;
     w.show();
     return app.exec();
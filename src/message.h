@@ -45,6 +45,7 @@ public:
     unsigned long long size;
 
     CommEvent * getDesignee();
+    bool isMessage() { return true; }
 
     bool operator<(const Message &);
     bool operator>(const Message &);
@@ -37,10 +37,11 @@ bool Metrics::hasMetric(QString name)
 
 double Metrics::getMetric(QString name, bool aggregate)
 {
+    // value() rather than [] so concurrent readers never touch the map
     if (aggregate)
-        return ((*metrics)[name])->aggregate;
+        return (metrics->value(name))->aggregate;
 
-    return ((*metrics)[name])->event;
+    return (metrics->value(name))->event;
 }
 
 QList<QString> Metrics::getMetricList()
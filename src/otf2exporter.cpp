@@ -31,6 +31,10 @@
 #include "function.h"
 #include "rpartition.h"
 #include "primaryentitygroup.h"
+#include "savedresults.h"
+#include <QDir>
+#include <QMutex>
+#include <QtConcurrent>
 #include <climits>
 #include <cmath>
 #include <iostream>
@@ -43,18 +47,57 @@ OTF2Exporter::OTF2Exporter(Trace *_t)
       archive(NULL),
       global_def_writer(NULL),
       inverseStringMap(QMap<QString, int>()),
-      attributeMap(new QMap<QString, int>())
+      results(NULL)
 {
     flush_callbacks.otf2_post_flush = OTF2Exporter::post_flush;
     flush_callbacks.otf2_pre_flush = OTF2Exporter::pre_flush;
+
+    locking_callbacks.otf2_release = OTF2Exporter::lock_release;
+    locking_callbacks.otf2_create = OTF2Exporter::lock_create;
+    locking_callbacks.otf2_destroy = OTF2Exporter::lock_destroy;
+    locking_callbacks.otf2_lock = OTF2Exporter::lock_lock;
+    locking_callbacks.otf2_unlock = OTF2Exporter::lock_unlock;
 }
 
 OTF2Exporter::~OTF2Exporter()
 {
-    delete attributeMap;
+    delete results;
+}
+
+// OTF2 leaves the lock type up to us
+struct OTF2_LockObject {
+    QMutex mutex;
+};
+
+OTF2_CallbackCode OTF2Exporter::lock_create(void * userData, OTF2_Lock * lock)
+{
+    Q_UNUSED(userData);
+    *lock = new OTF2_LockObject();
+    return OTF2_CALLBACK_SUCCESS;
+}
+
+OTF2_CallbackCode OTF2Exporter::lock_destroy(void * userData, OTF2_Lock lock)
+{
+    Q_UNUSED(userData);
+    delete lock;
+    return OTF2_CALLBACK_SUCCESS;
+}
+
+OTF2_CallbackCode OTF2Exporter::lock_lock(void * userData, OTF2_Lock lock)
+{
+    Q_UNUSED(userData);
+    lock->mutex.lock();
+    return OTF2_CALLBACK_SUCCESS;
+}
+
+OTF2_CallbackCode OTF2Exporter::lock_unlock(void * userData, OTF2_Lock lock)
+{
+    Q_UNUSED(userData);
+    lock->mutex.unlock();
+    return OTF2_CALLBACK_SUCCESS;
 }
 
-void OTF2Exporter::exportTrace(QString path, QString filename)
+bool OTF2Exporter::exportTrace(QString path, QString filename)
 {
     // Setup the IDs for partition identification
     for (int i = 0; i < trace->partitions->size(); i++)
@@ -79,22 +122,56 @@ void OTF2Exporter::exportTrace(QString path, QString filename)
                                 OTF2_SUBSTRATE_POSIX, OTF2_COMPRESSION_NONE);
 
     OTF2_Archive_SetFlushCallbacks(archive, &flush_callbacks, NULL);
+    OTF2_Archive_SetLockingCallbacks(archive, &locking_callbacks, NULL);
     OTF2_Archive_SetSerialCollectiveCallbacks(archive);
     exportDefinitions();
+
+    results = new SavedResults(trace->metrics, trace->roots->size());
     exportEvents();
 
     OTF2_Archive_Close(archive);
+
+    // Phases, steps, metrics, gnome types and step times are columns in
+    // a sidecar.
+    // Without it the save only holds the events.
+    results->setGnomeTypes(trace->partitions);
+    results->setStepTimes(trace);
+    bool saved = results->save(SavedResults::fileName(QDir(path).filePath(filename
+                                                                           + ".otf2")));
+    delete results;
+    results = NULL;
+    if (!saved)
+    {
+        std::cout << "Could not save analysis results, the trace will be "
+                  << "reprocessed when loaded." << std::endl;
+        return false;
+    }
+
+    // Clusterings go in a sidecar so loading the save can skip reclustering
+    if (trace->options.cluster)
+        return trace->saveClusters(Trace::clusterFileName(QDir(path).filePath(filename
+                                                                              + ".otf2")));
+    return true;
 }
 
+// Functor to write each entity's event stream in the thread pool
+struct ExportEntityEvents {
+    ExportEntityEvents(OTF2Exporter * _exporter) : exporter(_exporter) {}
+    typedef void result_type;
+    void operator()(Entity * entity) const {
+        exporter->exportEntityEvents(entity->id);
+    }
+
+    OTF2Exporter * exporter;
+};
+
+// Each entity has its own event writer and the archive is guarded by
+// the locking callbacks, so the streams can be written concurrently.
 void OTF2Exporter::exportEvents()
 {
     OTF2_Archive_OpenEvtFiles(archive);
 
-    for (QList<Entity *>::Iterator entity = entities->begin();
-         entity != entities->end(); ++entity)
-    {
-        exportEntityEvents((*entity)->id);
-    }
+    QtConcurrent::blockingMap(*entities, ExportEntityEvents(this));
 
     OTF2_Archive_CloseEvtFiles(archive);
 }
@@ -104,10 +181,11 @@ void OTF2Exporter::exportEntityEvents(unsigned long entityid)
     QVector<Event *> * roots = trace->roots->at(entityid);
     OTF2_EvtWriter * evt_writer = OTF2_Archive_GetEvtWriter(archive,
                                                             entityid);
+
     for (QVector<Event *>::Iterator root = roots->begin();
          root != roots->end(); ++root)
     {
-        (*root)->writeToOTF2(evt_writer, attributeMap);
+        (*root)->writeToOTF2(evt_writer, results);
     }
 
     OTF2_Archive_CloseEvtWriter(archive, evt_writer);
@@ -144,8 +222,9 @@ void OTF2Exporter::exportDefinitions()
 
 }
 
-// This includes both Ravel information and any ravel metrics.
-// We do this as attributes to keep with the event rather than separate.
+// This includes both Ravel information and any ravel metrics. The values
+// themselves are in the SavedResults sidecar, these name them and carry
+// the units.
 void OTF2Exporter::exportAttributes()
 {
     // Metrics
@@ -159,7 +238,6 @@ void OTF2Exporter::exportAttributes()
                                             inverseStringMap.value(*metric),
                                             inverseStringMap.value(trace->metric_units->value(*metric)),
                                             OTF2_TYPE_UINT64);
-        attributeMap->insert(*metric, id);
         id++;
 
         // One for the aggregate
@@ -168,7 +246,6 @@ void OTF2Exporter::exportAttributes()
                                             inverseStringMap.value(*metric + "_agg"),
                                             inverseStringMap.value(trace->metric_units->value(*metric)),
                                             OTF2_TYPE_UINT64);
-        attributeMap->insert(*metric + "_agg", id);
         id++;
     }
 
@@ -179,7 +256,6 @@ void OTF2Exporter::exportAttributes()
                                         ravel_version_string + 1,
                                         0,
                                         OTF2_TYPE_UINT64);
-    attributeMap->insert("phase", id);
     id++;
 
     // Step attribute
@@ -188,7 +264,6 @@ void OTF2Exporter::exportAttributes()
                                         ravel_version_string + 2,
                                         0,
                                         OTF2_TYPE_UINT64);
-    attributeMap->insert("step", id);
     id++;
 
     // Write Ravel information
@@ -317,7 +392,7 @@ void OTF2Exporter::exportStrings()
     counter = addString("", counter);
     counter = addString("Ravel", counter);
     ravel_string = counter;
-    counter = addString("0.9.0", counter);
+    counter = addString(SavedResults::save_version, counter);
     ravel_version_string = counter;
     counter = addString("phase", counter);
     counter = addString("step", counter);
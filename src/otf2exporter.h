@@ -32,6 +32,7 @@
 
 class Trace;
 class Entity;
+class SavedResults;
 
 class OTF2Exporter
 {
@@ -39,7 +40,7 @@ public:
     OTF2Exporter(Trace * _t);
     ~OTF2Exporter();
 
-    void exportTrace(QString path, QString filename);
+    bool exportTrace(QString path, QString filename);
 
     static OTF2_FlushType
     pre_flush( void*            userData,
@@ -67,7 +68,31 @@ public:
         return 0;
     }
 
+    // Locks handed to OTF2 so entities can be written from the thread pool
+    static OTF2_CallbackCode
+    lock_create( void*      userData,
+                 OTF2_Lock* lock );
+
+    static OTF2_CallbackCode
+    lock_destroy( void*     userData,
+                  OTF2_Lock lock );
+
+    static OTF2_CallbackCode
+    lock_lock( void*     userData,
+               OTF2_Lock lock );
+
+    static OTF2_CallbackCode
+    lock_unlock( void*     userData,
+                 OTF2_Lock lock );
+
+    static void
+    lock_release( void* userData )
+    {
+        Q_UNUSED(userData);
+    }
+
     OTF2_FlushCallbacks flush_callbacks;
+    OTF2_LockingCallbacks locking_callbacks;
 
 private:
     Trace * trace;
@@ -89,7 +114,9 @@ private:
     void exportEntityEvents(unsigned long entityid);
 
     QMap<QString, int> inverseStringMap;
-    QMap<QString, int> * attributeMap;
+    SavedResults * results;
+
+    friend struct ExportEntityEvents;
 };
 
 #endif // OTF2EXPORTER_H
@@ -42,7 +42,9 @@ void OTF2ExportFunctor::exportTrace(Trace * trace, const QString& path,
     traceTimer.start();
 
     OTF2Exporter * exporter = new OTF2Exporter(trace);
-    exporter->exportTrace(path, filename);
+    if (!exporter->exportTrace(path, filename))
+        std::cout << "Export of " << filename.toStdString().c_str()
+                  << " is incomplete" << std::endl;
 
     traceElapsed = traceTimer.nsecsElapsed();
     RavelUtils::gu_printTime(traceElapsed, "Total export time: ");
@@ -311,6 +311,7 @@ RawTrace * OTF2Importer::importOTF2(const char* otf_file, bool _enforceMessageSi
     rawtrace->collectiveBits = new QVector<QVector<RawTrace::CollectiveBit *> *>(num_processes);
     rawtrace->metric_names = metric_names;
     rawtrace->metric_units = metric_units;
+    rawtrace->from_saved_version = from_saved_version;
 
     // Adding locations
     // Use the locationIndexMap to only chooes the ones we can handle (right now just MPI)
@@ -802,7 +803,8 @@ OTF2_CallbackCode OTF2Importer::callbackLeave(OTF2_LocationRef locationID,
     ((*((((OTF2Importer*) userData)->rawtrace)->events))[location])->append(er);
 
     // Note, the leave is the only place the save file stores attributes, so
-    // we only need to check them here.
+    // we only need to check them here. Only older saves have them, newer
+    // ones keep these values in the SavedResults sidecar.
     if (OTF2_AttributeList_GetNumberOfElements(attributeList) > 0
         && ((OTF2Importer * ) userData)->from_saved_version.length() > 0)
     {
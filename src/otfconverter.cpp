@@ -54,6 +54,7 @@
 #include "collectiveevent.h"
 #include "primaryentitygroup.h"
 #include "metrics.h"
+#include "savedresults.h"
 
 
 const QString OTFConverter::collectives_string
@@ -63,12 +64,14 @@ const QString OTFConverter::collectives_string
       + QString("MPI_AllgathervMPI_GathervMPI_Scatterv");
 
 OTFConverter::OTFConverter()
-    : rawtrace(NULL), trace(NULL), options(NULL), phaseFunction(-1)
+    : rawtrace(NULL), trace(NULL), options(NULL), saved_results(NULL),
+      phaseFunction(-1)
 {
 }
 
 OTFConverter::~OTFConverter()
 {
+    delete saved_results;
 }
 
 
@@ -104,8 +107,46 @@ Trace * OTFConverter::importOTF2(QString filename, ImportOptions *_options)
                                     options->enforceMessageSizes);
     emit(finishRead());
 
+    // Saves newer than the attribute ones need their results sidecar,
+    // without it we have to process the trace from scratch.
+    if (rawtrace->options->origin == ImportOptions::OF_SAVE_OTF2
+        && rawtrace->from_saved_version != SavedResults::attribute_version)
+    {
+        saved_results = new SavedResults();
+        if (!saved_results->load(SavedResults::fileName(filename)))
+        {
+            std::cout << "Could not read saved results, reprocessing trace."
+                      << std::endl;
+            delete saved_results;
+            saved_results = NULL;
+            rawtrace->options->origin = ImportOptions::OF_OTF2;
+            options = _options;
+        }
+    }
+
     convert();
 
+    // Results that don't line up with the events would misplace every
+    // phase, step and metric after the first miss, so start over from
+    // the events alone. The saved options went with the first rawtrace, so
+    // like a missing sidecar this uses the caller's options.
+    if (saved_results && !saved_results->matched())
+    {
+        std::cout << "Saved results do not match trace, reprocessing trace."
+                  << std::endl;
+        delete saved_results;
+        saved_results = NULL;
+        delete trace;
+        delete importer;
+
+        options = _options;
+        importer = new OTF2Importer();
+        rawtrace = importer->importOTF2(filename.toStdString().c_str(),
+                                        options->enforceMessageSizes);
+        rawtrace->options->origin = ImportOptions::OF_OTF2;
+        convert();
+    }
+
     delete importer;
     trace->fullpath = filename;
     return trace;
@@ -171,6 +212,14 @@ void OTFConverter::convert()
         }
 
         matchEventsSaved();
+        // Gnome types let gnomify skip detection if the clusters need
+        // redoing, step times save a pass over the events
+        if (saved_results)
+        {
+            trace->saved_gnome_types
+                = saved_results->applyGnomeTypes(trace->partitions);
+            saved_results->applyStepTimes(trace);
+        }
     }
     else
     {
@@ -1286,6 +1335,13 @@ void OTFConverter::addToSavedPartition(CommEvent * evt, int partition)
 
 void OTFConverter::handleSavedAttributes(CommEvent * evt, EventRecord * er)
 {
+    // Misses are caught by SavedResults::matched once all events are built
+    if (saved_results)
+    {
+        saved_results->apply(er->entity, evt);
+        return;
+    }
+
     evt->phase = er->ravel_info->value("phase");
     evt->step = er->ravel_info->value("step");
 
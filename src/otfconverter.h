@@ -39,6 +39,7 @@ class Partition;
 class CommEvent;
 class CounterRecord;
 class EventRecord;
+class SavedResults;
 
 // Uses the raw records read from the OTF:
 // - switches point events into durational events
@@ -75,6 +76,7 @@ private:
     RawTrace * rawtrace;
     Trace * trace;
     ImportOptions * options;
+    SavedResults * saved_results;
     int phaseFunction;
 
     static const int event_match_portion = 24;
@@ -177,51 +177,8 @@ void OverviewVis::setTrace(Trace * t)
     VisWidget::setTrace(t);
     cacheMetric = options->metric;
     maxStep = trace->global_max_step;
-    minTime = ULLONG_MAX;
-    maxTime = 0;
-    //unsigned long long init_time = ULLONG_MAX;
-    //unsigned long long finalize_time = 0;
-    // Maybe we should have this be by step instead? We'll see. Right now it
-    // uses the full events list which seems unnecessary
-
-    // PreVis commented to change
-    /*for (QList<Partition *>::Iterator part = trace->partitions->begin(); part != trace->partitions->end(); ++part)
-    {
-        for (QMap<int, QList<Event *>*>::Iterator elist = (*part)->events->begin(); elist != (*part)->events->end(); ++elist)
-        {
-            for (QList<Event *>::Iterator evt = (elist.value())->begin(); evt != (elist.value())->end(); ++evt)
-            {
-                if ((*evt)->enter < minTime)
-                    minTime = (*evt)->enter;
-                if ((*evt)->exit > maxTime)
-                    maxTime = (*evt)->exit;
-            }
-
-        }
-
-    }
-    */
-
-    /*for (QVector<QVector<Event *> *>::Iterator eitr = trace->events->begin(); eitr != trace->events->end(); ++eitr)
-    {
-        for (QVector<Event *>::Iterator itr = (*eitr)->begin(); itr != (*eitr)->end(); ++itr)
-        {
-            if ((*itr)->enter > maxTime)
-                maxTime = (*itr)->enter;
-            if ((*itr)->exit < minTime)
-                minTime = (*itr)->exit;
-            if ((*itr)->enter > finalize_time && ((*(trace->functions))[(*itr)->function])->name == "MPI_Finalize")
-                finalize_time = (*itr)->enter; // Last MPI_Finalize enter
-            if ((*itr)->exit < init_time && ((*(trace->functions))[(*itr)->function])->name == "MPI_Init")
-                init_time = (*itr)->exit; // Earliest MPI_Init exit
-        }
-    }*/
-
-    /*if (finalize_time > 0)
-        maxTime = std::min(maxTime, finalize_time);
-    if (init_time < ULLONG_MAX)
-        minTime = std::max(minTime, init_time);
-        */
+    minTime = trace->min_time;
+    maxTime = trace->max_time;
 
     startTime = minTime;
     stopTime = minTime;
@@ -232,9 +189,8 @@ void OverviewVis::setTrace(Trace * t)
 }
 
 
-// Calculate what the heights should be for the metrics
-// TODO: Save this stuff per step somewhere and have that be accessed as needed
-// rather than iterating through everything
+// Calculate what the heights should be for the metrics from the per-step
+// summaries kept by the trace
 void OverviewVis::processVis()
 {
     // Don't do anything if there's no trace available
@@ -247,63 +203,51 @@ void OverviewVis::processVis()
     int start_int, stop_int;
     QString metric = options->metric;
     //stepPositions = QVector<std::pair<int, int> >(maxStep+1, std::pair<int, int>(width + 1, -1));
-    for (QList<Partition *>::Iterator part = trace->partitions->begin();
-         part != trace->partitions->end(); ++part)
+
+    // For each step, we figure out which cursor positions it spans and then
+    // we accumulate height over those based on the summed metric value of
+    // the step's events. The aggregates are drawn at the step before.
+    QVector<Trace::StepMetric> * step_metrics = trace->getStepMetrics(metric);
+    for (int step = 0; step < step_metrics->size(); step++)
     {
-        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
-             = (*part)->events->begin();
-             event_list != (*part)->events->end(); ++event_list)
+        const Trace::StepMetric& sm = step_metrics->at(step);
+
+        // start and stop are the cursor positions
+        float start = (width - 1) * (step / 1.0 / stepspan);
+        float stop = start + stepWidth;
+        start_int = static_cast<int>(start);
+        stop_int = static_cast<int>(stop);
+
+        if (sm.event_sum > 0)
         {
-            // For each event, we figure out which steps it spans and then we
-            // accumulate height over those steps based on the event's metric
-            // value
-            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-                 evt != (event_list.value())->end(); ++evt)
+            heights[start_int] += sm.event_sum * (start - start_int);
+            if (stop_int != start_int) {
+                heights[stop_int] += sm.event_sum * (stop - stop_int);
+            }
+            for (int i = start_int + 1; i < stop_int; i++)
+            {
+                heights[i] += sm.event_sum;
+            }
+        }
+
+        // again for the aggregate
+        if (step == 0)
+            continue;
+        start = (width - 1) * ((step - 1) / 1.0 / stepspan);
+        stop = start + stepWidth;
+        start_int = static_cast<int>(start);
+        stop_int = static_cast<int>(stop); // start_int + i_step_width;
+
+        if (sm.agg_sum > 0)
+        {
+            heights[start_int] += sm.agg_sum * (start - start_int);
+            if (stop_int != start_int)
+            {
+                heights[stop_int] += sm.agg_sum * (stop - stop_int);
+            }
+            for (int i = start_int + 1; i < stop_int; i++)
             {
-                // start and stop are the cursor positions
-                float start = (width - 1) * (((*evt)->step) / 1.0 / stepspan);
-                float stop = start + stepWidth;
-                start_int = static_cast<int>(start);
-                stop_int = static_cast<int>(stop);
-
-                if ((*evt)->hasMetric(metric) && (*evt)->getMetric(metric)> 0)
-                {
-                    heights[start_int] += (*evt)->getMetric(metric)
-                                          * (start - start_int);
-                    if (stop_int != start_int) {
-                        heights[stop_int] += (*evt)->getMetric(metric)
-                                             * (stop - stop_int);
-                    }
-                    for (int i = start_int + 1; i < stop_int; i++)
-                    {
-                        heights[i] += (*evt)->getMetric(metric);
-                    }
-
-                }
-
-                // again for the aggregate
-                if ((*evt)->step == 0)
-                    continue;
-                start = (width - 1) * (((*evt)->step - 1) / 1.0 / stepspan);
-                stop = start + stepWidth;
-                start_int = static_cast<int>(start);
-                stop_int = static_cast<int>(stop); // start_int + i_step_width;
-
-                if ((*evt)->hasMetric(metric)
-                        && (*evt)->getMetric(metric, true)> 0)
-                {
-                    heights[start_int] += (*evt)->getMetric(metric, true)
-                                          * (start - start_int);
-                    if (stop_int != start_int)
-                    {
-                        heights[stop_int] += (*evt)->getMetric(metric, true)
-                                             * (stop - stop_int);
-                    }
-                    for (int i = start_int + 1; i < stop_int; i++)
-                    {
-                        heights[i] += (*evt)->getMetric(metric, true);
-                    }
-                }
+                heights[i] += sm.agg_sum;
             }
         }
     }
@@ -551,7 +551,7 @@ QList<int> P2PEvent::neighborEntities()
 
 // Here between the enter and leave we know we have no children as normal,
 // but we do have subevents. So we want to write those as the correct time.
-void P2PEvent::writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap)
+void P2PEvent::writeToOTF2(OTF2_EvtWriter * writer, SavedResults * results)
 {
     writeOTF2Enter(writer);
 
@@ -560,7 +560,7 @@ void P2PEvent::writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> * attribu
         for (QList<P2PEvent *>::Iterator sub = subevents->begin();
              sub != subevents->end(); ++sub)
         {
-            (*sub)->writeToOTF2(writer, attributeMap);
+            (*sub)->writeToOTF2(writer, results);
         }
     }
 
@@ -596,5 +596,5 @@ void P2PEvent::writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> * attribu
 
     }
 
-    writeOTF2Leave(writer, attributeMap);
+    writeOTF2Leave(writer, results);
 }
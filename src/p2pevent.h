@@ -62,7 +62,7 @@ public:
     void calculate_differential_metric(QString metric_name,
                                        QString base_name,
                                        bool aggregates);
-    void writeToOTF2(OTF2_EvtWriter * writer, QMap<QString, int> * attributeMap);
+    void writeToOTF2(OTF2_EvtWriter * writer, SavedResults * results);
 
     void track_delay(QPainter *painter, CommDrawInterface * vis);
     CommEvent * compare_to_sender(CommEvent * prev);
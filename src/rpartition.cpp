@@ -63,9 +63,6 @@ Partition::Partition()
       gvid(""),
       gnome(NULL),
       gnome_type(0),
-      cluster_entities(new QVector<ClusterEntity *>()),
-      cluster_vectors(new QMap<int, QVector<long long int> *>()),
-      cluster_step_starts(new QMap<int, int>()),
       debug_mark(false),
       debug_name(-1),
       debug_functions(NULL),
@@ -90,14 +87,6 @@ Partition::~Partition()
     delete old_children;
     delete metrics;
     delete gnome;
-
-    for (QMap<int, QVector<long long int> *>::Iterator itr = cluster_vectors->begin();
-         itr != cluster_vectors->end(); ++itr)
-    {
-        delete itr.value();
-    }
-    delete cluster_vectors;
-    delete cluster_step_starts;
 }
 
 // Call when we are sure we want to delete events held in this partition
@@ -1249,43 +1238,30 @@ void Partition::calculate_imbalance(int num_pes)
     }
 }
 
-void Partition::makeClusterVectors(QString metric)
+// Create a ClusterEntity for each entity with its metric_events filled in
+// so missing steps take the previous metric value. The caller owns the
+// result. This only reads the events so clusterings for different metrics
+// may be built concurrently.
+QVector<ClusterEntity *> * Partition::makeClusterEntities(QString metric)
 {
-    // Clean up old
-    for (QMap<int, QVector<long long int> *>::Iterator itr =  cluster_vectors->begin();
-         itr != cluster_vectors->end(); ++itr)
+    QVector<ClusterEntity *> * cluster_entities
+            = new QVector<ClusterEntity *>();
+    cluster_entities->reserve(events->size());
+    for (QMap<unsigned long, QList<CommEvent *> *>::ConstIterator event_list
+         = events->constBegin(); event_list != events->constEnd(); ++event_list)
     {
-        delete itr.value();
-    }
-    for (QVector<ClusterEntity *>::Iterator itr
-         = cluster_entities->begin(); itr != cluster_entities->end(); ++itr)
-    {
-        delete *itr;
-    }
-    cluster_entities->clear();
-    cluster_vectors->clear();
-    cluster_step_starts->clear();
-
-
-    // Create a ClusterEntity for each entity and in each set metric_events
-    // so it fills in the missing steps with the previous metric value.
-    for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list = events->begin();
-         event_list != events->end(); ++event_list)
-    {
-        QVector<long long int> * metric_vector = new QVector<long long int>();
-        (*cluster_vectors)[event_list.key()] = metric_vector;
         long long int last_value = 0;
         int last_step = (event_list.value())->at(0)->step;
-        (*cluster_step_starts)[event_list.key()] = last_step;
         ClusterEntity * cp = new ClusterEntity(event_list.key(), last_step);
+        cp->metric_events->reserve((max_global_step - last_step) / 2 + 1);
         cluster_entities->append(cp);
-        for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-             evt != (event_list.value())->end(); ++evt)
+        for (QList<CommEvent *>::ConstIterator evt
+             = (event_list.value())->constBegin();
+             evt != (event_list.value())->constEnd(); ++evt)
         {
             while ((*evt)->step > last_step + 2)
             {
                 // Fill in the previous known value
-                metric_vector->append(last_value);
                 cp->metric_events->append(last_value);
                 last_step += 2;
             }
@@ -1293,17 +1269,16 @@ void Partition::makeClusterVectors(QString metric)
             // Fill in our value
             last_step = (*evt)->step;
             last_value = (*evt)->getMetric(metric);
-            metric_vector->append(last_value);
             cp->metric_events->append(last_value);
         }
         while (last_step <= max_global_step)
         {
             // We're out of steps but fill in the rest
-            metric_vector->append(last_value);
             cp->metric_events->append(last_value);
             last_step += 2;
         }
     }
+    return cluster_entities;
 }
 
 // String giving process IDs involved in this partition
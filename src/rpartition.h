@@ -129,14 +129,9 @@ public:
     QString gvid;
 
     // For gnome and clustering
-    // Cluster_vectors simplify the coding of distance calculations
-    // between processes but don't aid performance so may be wasteful
     Gnome * gnome;
     int gnome_type;
-    QVector<ClusterEntity *> * cluster_entities;
-    void makeClusterVectors(QString metric);
-    QMap<int, QVector<long long int> *> * cluster_vectors;
-    QMap<int, int> * cluster_step_starts;
+    QVector<ClusterEntity *> * makeClusterEntities(QString metric);
 
     bool debug_mark;
     int debug_name;
@@ -0,0 +1,371 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "savedresults.h"
+#include "commevent.h"
+#include "rpartition.h"
+#include "metrics.h"
+#include "trace.h"
+#include <QFile>
+#include <QDataStream>
+#include <QSysInfo>
+#include <qnumeric.h>
+#include <limits>
+#include <iostream>
+
+const QString SavedResults::save_version = "0.9.1";
+const QString SavedResults::attribute_version = "0.9.0";
+
+SavedResults::SavedResults()
+    : metrics(QList<QString>()),
+      num_locations(0),
+      min_time(0),
+      max_time(0),
+      location_columns(QVector<QVector<QByteArray> *>()),
+      gnome_types(QByteArray()),
+      step_starts(QByteArray()),
+      step_stops(QByteArray()),
+      columns(QVector<QByteArray>()),
+      location_rows(QVector<int>()),
+      cursors(QVector<int>()),
+      mismatched(false)
+{
+}
+
+SavedResults::SavedResults(QList<QString> * _metrics, int _num_locations)
+    : metrics(*_metrics),
+      num_locations(_num_locations),
+      min_time(0),
+      max_time(0),
+      location_columns(QVector<QVector<QByteArray> *>(_num_locations)),
+      gnome_types(QByteArray()),
+      step_starts(QByteArray()),
+      step_stops(QByteArray()),
+      columns(QVector<QByteArray>()),
+      location_rows(QVector<int>()),
+      cursors(QVector<int>()),
+      mismatched(false)
+{
+    for (int i = 0; i < num_locations; i++)
+        location_columns[i] = new QVector<QByteArray>(numColumns());
+}
+
+SavedResults::~SavedResults()
+{
+    for (QVector<QVector<QByteArray> *>::Iterator ec = location_columns.begin();
+         ec != location_columns.end(); ++ec)
+    {
+        delete *ec;
+    }
+}
+
+QString SavedResults::fileName(QString otf2file)
+{
+    if (otf2file.endsWith(".otf2"))
+        otf2file.chop(5);
+    return otf2file + ".results";
+}
+
+// Add a row for an event whose leave is being written to location. Each
+// location has its own columns so locations may be written from different
+// threads.
+void SavedResults::append(unsigned long location, CommEvent * evt)
+{
+    QVector<QByteArray> * ec = location_columns.at(location);
+    qint32 phase = evt->phase, step = evt->step;
+    (*ec)[PhaseColumn].append((const char *) &phase, sizeof(qint32));
+    (*ec)[StepColumn].append((const char *) &step, sizeof(qint32));
+
+    // Metrics the event doesn't have are NaN
+    double value;
+    for (int i = 0; i < metrics.size(); i++)
+    {
+        if (evt->metrics->hasMetric(metrics.at(i)))
+            value = evt->metrics->getMetric(metrics.at(i));
+        else
+            value = std::numeric_limits<double>::quiet_NaN();
+        (*ec)[metricColumn(i, false)].append((const char *) &value, sizeof(double));
+
+        if (evt->metrics->hasMetric(metrics.at(i)))
+            value = evt->metrics->getMetric(metrics.at(i), true);
+        (*ec)[metricColumn(i, true)].append((const char *) &value, sizeof(double));
+    }
+}
+
+// Partitions are indexed by the phase the exporter gave them
+void SavedResults::setGnomeTypes(QList<Partition *> * partitions)
+{
+    gnome_types.clear();
+    for (QList<Partition *>::Iterator part = partitions->begin();
+         part != partitions->end(); ++part)
+    {
+        qint32 gnome_type = (*part)->gnome_type;
+        gnome_types.append((const char *) &gnome_type, sizeof(qint32));
+    }
+}
+
+// Time extents so loading doesn't have to scan every event for them
+void SavedResults::setStepTimes(Trace * trace)
+{
+    min_time = trace->min_time;
+    max_time = trace->max_time;
+    step_starts.clear();
+    step_stops.clear();
+    for (QVector<Trace::StepTime>::Iterator st = trace->step_times->begin();
+         st != trace->step_times->end(); ++st)
+    {
+        quint64 start = st->start, stop = st->stop;
+        step_starts.append((const char *) &start, sizeof(quint64));
+        step_stops.append((const char *) &stop, sizeof(quint64));
+    }
+}
+
+// The header is a QDataStream, then each column is its compressed length
+// followed by the qCompress'd bytes in host byte order.
+bool SavedResults::save(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        std::cout << "Could not write results to "
+                  << filename.toStdString().c_str() << std::endl;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << results_file_magic << results_file_version
+        << (qint32) QSysInfo::ByteOrder << (qint32) num_locations
+        << min_time << max_time << (qint32) metrics.size();
+    for (QList<QString>::Iterator metric = metrics.begin();
+         metric != metrics.end(); ++metric)
+    {
+        out << *metric;
+    }
+
+    QByteArray column;
+    for (int c = 0; c < numColumns(); c++)
+    {
+        column.clear();
+        if (c == RowsColumn)
+        {
+            for (int i = 0; i < num_locations; i++)
+            {
+                qint32 rows = location_columns.at(i)->at(PhaseColumn).size()
+                              / sizeof(qint32);
+                column.append((const char *) &rows, sizeof(qint32));
+            }
+        }
+        else if (c == GnomeColumn)
+        {
+            column = gnome_types;
+        }
+        else if (c == StepStartColumn)
+        {
+            column = step_starts;
+        }
+        else if (c == StepStopColumn)
+        {
+            column = step_stops;
+        }
+        else
+        {
+            for (int i = 0; i < num_locations; i++)
+            {
+                column.append(location_columns.at(i)->at(c));
+                (*(location_columns[i]))[c].clear(); // Done with it
+            }
+        }
+
+        QByteArray compressed = qCompress(column);
+        out << (qint32) compressed.size();
+        out.writeRawData(compressed.constData(), compressed.size());
+    }
+
+    file.close();
+    return out.status() == QDataStream::Ok;
+}
+
+// Map the file and inflate the columns straight out of the mapping.
+// Anything unexpected means the results can't be trusted.
+bool SavedResults::load(QString filename)
+{
+    QFile file(filename);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    uchar * data = file.map(0, file.size());
+    if (!data)
+        return false;
+
+    QByteArray mapped = QByteArray::fromRawData((const char *) data,
+                                                file.size());
+    QDataStream in(mapped);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    qint32 version = 0, byte_order = -1, saved_locations = 0, num_metrics = 0;
+    in >> magic >> version >> byte_order >> saved_locations
+       >> min_time >> max_time >> num_metrics;
+    if (in.status() != QDataStream::Ok || magic != results_file_magic
+        || version != results_file_version
+        || byte_order != (qint32) QSysInfo::ByteOrder
+        || saved_locations < 0 || num_metrics < 0)
+    {
+        file.unmap(data);
+        return false;
+    }
+
+    metrics.clear();
+    QString metric;
+    for (int i = 0; i < num_metrics; i++)
+    {
+        in >> metric;
+        metrics.append(metric);
+    }
+    num_locations = saved_locations;
+
+    bool valid = in.status() == QDataStream::Ok;
+    qint32 length;
+    columns.resize(numColumns());
+    for (int c = 0; c < numColumns() && valid; c++)
+    {
+        in >> length;
+        qint64 offset = in.device()->pos();
+        if (in.status() != QDataStream::Ok || length < 0
+            || offset + length > file.size())
+        {
+            valid = false;
+            break;
+        }
+        columns[c] = qUncompress(data + offset, length);
+        in.skipRawData(length);
+    }
+    file.unmap(data);
+    file.close();
+
+    // Prefix sum the row counts and make sure every column has them all
+    if (valid)
+        valid = columns.at(RowsColumn).size()
+                == num_locations * (int) sizeof(qint32);
+    if (valid)
+    {
+        const qint32 * rows = (const qint32 *) columns.at(RowsColumn).constData();
+        location_rows.resize(num_locations + 1);
+        location_rows[0] = 0;
+        for (int i = 0; i < num_locations; i++)
+            location_rows[i + 1] = location_rows[i] + rows[i];
+        int total = location_rows.last();
+        valid = columns.at(PhaseColumn).size() == total * (int) sizeof(qint32)
+                && columns.at(StepColumn).size() == total * (int) sizeof(qint32)
+                && columns.at(StepStartColumn).size()
+                   == columns.at(StepStopColumn).size();
+        for (int i = 0; i < metrics.size() && valid; i++)
+            valid = columns.at(metricColumn(i, false)).size()
+                        == total * (int) sizeof(double)
+                    && columns.at(metricColumn(i, true)).size()
+                        == total * (int) sizeof(double);
+    }
+    if (!valid)
+    {
+        columns.clear();
+        location_rows.clear();
+        return false;
+    }
+
+    cursors.fill(0, num_locations);
+    mismatched = false;
+    return true;
+}
+
+// Fill in the next row of the location the event's leave was read from
+bool SavedResults::apply(unsigned long location, CommEvent * evt)
+{
+    if (location >= (unsigned long) num_locations)
+    {
+        mismatched = true;
+        return false;
+    }
+    int row = location_rows.at(location) + cursors.at(location);
+    if (row >= location_rows.at(location + 1))
+    {
+        mismatched = true;
+        return false;
+    }
+    cursors[location]++;
+
+    evt->phase = ((const qint32 *) columns.at(PhaseColumn).constData())[row];
+    evt->step = ((const qint32 *) columns.at(StepColumn).constData())[row];
+    for (int i = 0; i < metrics.size(); i++)
+    {
+        double value = ((const double *) columns.at(metricColumn(i, false)).constData())[row];
+        if (qIsNaN(value))
+            continue;
+        evt->metrics->addMetric(metrics.at(i), value,
+                                ((const double *) columns.at(metricColumn(i, true)).constData())[row]);
+    }
+    return true;
+}
+
+// Whether every event got a row and every row went to an event, i.e. the
+// row counts of each location agree with the events rebuilt from the trace
+bool SavedResults::matched()
+{
+    if (mismatched)
+        return false;
+    for (int i = 0; i < num_locations; i++)
+    {
+        if (location_rows.at(i) + cursors.at(i) != location_rows.at(i + 1))
+            return false;
+    }
+    return true;
+}
+
+// Only usable if there is a type for every partition
+bool SavedResults::applyGnomeTypes(QList<Partition *> * partitions)
+{
+    const qint32 * types = (const qint32 *) columns.at(GnomeColumn).constData();
+    int num_types = columns.at(GnomeColumn).size() / sizeof(qint32);
+    if (num_types != partitions->size())
+        return false;
+
+    for (int i = 0; i < num_types; i++)
+        partitions->at(i)->gnome_type = types[i];
+    return true;
+}
+
+// The trace checks these fit its steps before using them
+void SavedResults::applyStepTimes(Trace * trace)
+{
+    const quint64 * starts = (const quint64 *) columns.at(StepStartColumn).constData();
+    const quint64 * stops = (const quint64 *) columns.at(StepStopColumn).constData();
+    int num_steps = columns.at(StepStartColumn).size() / sizeof(quint64);
+    trace->min_time = min_time;
+    trace->max_time = max_time;
+    trace->step_times->resize(num_steps);
+    for (int i = 0; i < num_steps; i++)
+    {
+        (*(trace->step_times))[i].start = starts[i];
+        (*(trace->step_times))[i].stop = stops[i];
+    }
+}
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef SAVEDRESULTS_H
+#define SAVEDRESULTS_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+class CommEvent;
+class Partition;
+class Trace;
+
+// Analysis results of a saved trace (phase, step and metrics of every
+// communication event, the partition gnome types and the step times). These are kept
+// beside the OTF2 archive as compressed columns rather than as attributes
+// on every leave record. Rows are kept per OTF2 location (event stream),
+// not per entity, as Charm++ streams hold the events of many chares. Rows
+// for each location are in the order the exporter writes its leaves, which
+// is the order the converter rebuilds the events in.
+class SavedResults
+{
+public:
+    SavedResults(); // For loading
+    SavedResults(QList<QString> * _metrics, int num_locations); // For saving
+    ~SavedResults();
+
+    // The results for run.otf2 are in run.results
+    static QString fileName(QString otf2file);
+
+    static const QString save_version;
+    // Saves of this version keep results as leave attributes instead
+    static const QString attribute_version;
+
+    // Saving, append is safe to call concurrently for different locations
+    void append(unsigned long location, CommEvent * evt);
+    void setGnomeTypes(QList<Partition *> * partitions);
+    void setStepTimes(Trace * trace);
+    bool save(QString filename);
+
+    // Loading
+    bool load(QString filename);
+    bool apply(unsigned long location, CommEvent * evt);
+    bool matched();
+    bool applyGnomeTypes(QList<Partition *> * partitions);
+    void applyStepTimes(Trace * trace);
+
+private:
+    enum Column {
+        RowsColumn = 0, // rows per location
+        GnomeColumn, // gnome type per partition
+        PhaseColumn,
+        StepColumn,
+        StepStartColumn, // step times per event step
+        StepStopColumn,
+        FirstMetricColumn // then event, aggregate for each metric
+    };
+
+    int metricColumn(int metric, bool aggregate)
+        { return FirstMetricColumn + 2 * metric + (aggregate ? 1 : 0); }
+    int numColumns() { return FirstMetricColumn + 2 * metrics.size(); }
+
+    QList<QString> metrics;
+    int num_locations;
+    quint64 min_time;
+    quint64 max_time;
+
+    // Saving: per location row columns
+    QVector<QVector<QByteArray> *> location_columns;
+    QByteArray gnome_types;
+    QByteArray step_starts;
+    QByteArray step_stops;
+
+    // Loading: inflated columns and first row of each location
+    QVector<QByteArray> columns;
+    QVector<int> location_rows;
+    QVector<int> cursors;
+    bool mismatched; // an event had no row
+
+    static const quint32 results_file_magic = 0x5252534c; // "RRSL"
+    static const qint32 results_file_version = 3;
+};
+
+#endif // SAVEDRESULTS_H
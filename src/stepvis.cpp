@@ -36,14 +36,21 @@
 #include "collectiveevent.h"
 #include "primaryentitygroup.h"
 #include "entity.h"
+#include "barbuffer.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include <QLocale>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QLinearGradient>
 
 #include "function.h"
 
+// Packed color of events without the current metric, never produced by the
+// colormap since its colors are opaque
+static const QRgb noMetricColor = 0x00B4B4B4;
+
 StepVis::StepVis(QWidget* parent, VisOptions * _options)
     : TimelineVis(parent = parent, _options),
       metricdialog(NULL),
@@ -59,7 +66,14 @@ StepVis::StepVis(QWidget* parent, VisOptions * _options)
       ellipse_width(0),
       ellipse_height(0),
       overdrawYMap(new QMap<int, int>()),
-      groupColorMap(new QMap<int, QColor>())
+      groupColorMap(new QMap<int, QColor>()),
+      partitionBars(QVector<int>()),
+      barAggregateSteps(false),
+      barGnome(NULL),
+      barEntities(QList<int>()),
+      colorMetric(""),
+      colorMap(NULL),
+      colorVersion(0)
 {
 
 }
@@ -159,35 +173,129 @@ void StepVis::processVis()
     }
     painter->end();
     delete painter;
+
+    buildStepIndex();
 }
 
+// Bucket events by step for each partition. Entities are visited in order
+// so each bucket comes out sorted by entity order.
+void StepVis::buildStepIndex()
+{
+    stepIndex = QVector<QVector<StepBucket> >(trace->partitions->size());
+    QList<QPair<unsigned long, unsigned long> > entity_orders;
+    int index;
+    for (int i = 0; i < trace->partitions->size(); ++i)
+    {
+        Partition * part = trace->partitions->at(i);
+        QVector<StepBucket>& buckets = stepIndex[i];
+        buckets.resize(part->max_global_step - part->min_global_step + 1);
 
-void StepVis::setupMetric()
+        entity_orders.clear();
+        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
+             = part->events->begin();
+             event_list != part->events->end(); ++event_list)
+        {
+            entity_orders.append(QPair<unsigned long, unsigned long>(proc_to_order[event_list.key()],
+                                                                     event_list.key()));
+        }
+        qSort(entity_orders);
+
+        for (QList<QPair<unsigned long, unsigned long> >::Iterator eo
+             = entity_orders.begin(); eo != entity_orders.end(); ++eo)
+        {
+            QList<CommEvent *> * elist = part->events->value(eo->second);
+            for (QList<CommEvent *>::Iterator evt = elist->begin();
+                 evt != elist->end(); ++evt)
+            {
+                index = (*evt)->step - part->min_global_step;
+                if (index < 0 || index >= buckets.size())
+                    continue;
+                buckets[index].orders.append(eo->first);
+                buckets[index].events.append(*evt);
+            }
+        }
+    }
+    colorMap = NULL;
+}
+
+// Recompute the packed bucket colors, only when the metric or the colormap
+// range has changed since they were last computed
+void StepVis::updateColors()
 {
-    // Find the maximum of a metric -- TODO: Move this into trace as a lookup
-    // some day before we do tiling
-    maxMetric = 0;
     QString metric(options->metric);
-    for (QList<Partition *>::Iterator part = trace->partitions->begin();
-         part != trace->partitions->end(); ++part)
+    ColorMap * colormap = options->colormap;
+    if (colorMap == colormap && colorVersion == colormap->getVersion()
+        && colorMetric == metric)
+        return;
+
+    colorMetric = metric;
+    colorMap = colormap;
+    colorVersion = colormap->getVersion();
+    CommEvent * evt;
+    for (int i = 0; i < stepIndex.size(); ++i)
     {
-        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
-             = (*part)->events->begin();
-             event_list != (*part)->events->end(); ++event_list)
+        for (QVector<StepBucket>::Iterator bucket = stepIndex[i].begin();
+             bucket != stepIndex[i].end(); ++bucket)
         {
-            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-                 evt != (event_list.value())->end(); ++evt)
+            bucket->colors.resize(bucket->events.size());
+            bucket->aggColors.resize(bucket->events.size());
+            for (int e = 0; e < bucket->events.size(); ++e)
             {
-                if ((*evt)->hasMetric(metric))
+                evt = bucket->events[e];
+                if (evt->hasMetric(metric))
+                {
+                    bucket->colors[e] = colormap->rgb(evt->getMetric(metric));
+                    bucket->aggColors[e] = colormap->rgb(evt->getMetric(metric,
+                                                                        true));
+                }
+                else
                 {
-                    if ((*evt)->getMetric(metric) > maxMetric)
-                        maxMetric = (*evt)->getMetric(metric);
-                    if ((*evt)->getMetric(metric, true) > maxMetric)
-                        maxMetric = (*evt)->getMetric(metric, true);
+                    bucket->colors[e] = noMetricColor;
+                    bucket->aggColors[e] = noMetricColor;
                 }
             }
         }
     }
+}
+
+// Bucket color at the given opacity. Events without the metric are
+// drawn opaque grey.
+static QColor bucketColor(QRgb rgb, float opacity)
+{
+    if (rgb == noMetricColor)
+        return QColor(180, 180, 180);
+    QColor color = QColor::fromRgb(rgb);
+    color.setAlpha(opacity * 255);
+    return color;
+}
+
+// Find [first, last) of the bucket within the visible entity span
+void StepVis::visibleBucketRange(const StepBucket& bucket, int& first,
+                                 int& last)
+{
+    unsigned long low = std::max(0.0, floor(startEntity));
+    unsigned long high = std::max(0.0, ceil(startEntity + entitySpan));
+    first = std::lower_bound(bucket.orders.begin(), bucket.orders.end(), low)
+            - bucket.orders.begin();
+    last = std::upper_bound(bucket.orders.begin(), bucket.orders.end(), high)
+           - bucket.orders.begin();
+}
+
+
+void StepVis::setupMetric()
+{
+    // Find the maximum of a metric from the trace's per-step summaries
+    maxMetric = 0;
+    QString metric(options->metric);
+    QVector<Trace::StepMetric> * step_metrics = trace->getStepMetrics(metric);
+    for (QVector<Trace::StepMetric>::Iterator sm = step_metrics->begin();
+         sm != step_metrics->end(); ++sm)
+    {
+        if (sm->event_max > maxMetric)
+            maxMetric = sm->event_max;
+        if (sm->agg_max > maxMetric)
+            maxMetric = sm->agg_max;
+    }
     options->setRange(0, maxMetric);
     cacheMetric = options->metric;
 
@@ -327,6 +435,8 @@ void StepVis::mouseMoveEvent(QMouseEvent * event)
         mousex = event->x();
         mousey = event->y();
         hoverText = "";
+        int hit = drawnEvents.find(mousex, mousey);
+        Event * hover_hit = (hit >= 0) ? drawnEvents.itemAt(hit) : NULL;
         if (mousey >= rect().height() - colorBarHeight) // color bar
         {
             if (event->x() < rect().width() - colorbar_offset
@@ -341,38 +451,29 @@ void StepVis::mouseMoveEvent(QMouseEvent * event)
             }
         }
         else if (options->showAggregateSteps && hover_event
-                 && drawnEvents[hover_event].contains(mousex, mousey)) // fxn
+                 && hover_hit == hover_event) // fxn
         {
             if (!hover_aggregate && mousex
-                <= drawnEvents[hover_event].x() + stepwidth)
+                <= drawnEvents.rectAt(hit).x() + stepwidth)
             {
                 hover_aggregate = true;
                 repaint();
             }
-            else if (hover_aggregate && mousex >=  drawnEvents[hover_event].x()
+            else if (hover_aggregate && mousex >=  drawnEvents.rectAt(hit).x()
                      + stepwidth)
             {
                 hover_aggregate = false;
                 repaint();
             }
         }
-        else if (hover_event == NULL
-                 || !drawnEvents[hover_event].contains(mousex, mousey))
+        else if (hover_event == NULL || hover_hit != hover_event)
         {
-            hover_event = NULL;
-            for (QMap<Event *, QRect>::Iterator evt = drawnEvents.begin();
-                 evt != drawnEvents.end(); ++evt)
+            hover_event = hover_hit;
+            hover_aggregate = false;
+            if (hover_hit && options->showAggregateSteps
+                && mousex <= drawnEvents.rectAt(hit).x() + stepwidth)
             {
-                if (evt.value().contains(mousex, mousey))
-                {
-                    hover_aggregate = false;
-                    if (options->showAggregateSteps && mousex
-                        <= evt.value().x() + stepwidth)
-                    {
-                        hover_aggregate = true;
-                    }
-                    hover_event = evt.key();
-                }
+                hover_aggregate = true;
             }
 
             repaint();
@@ -512,8 +613,6 @@ void StepVis::drawNativeGL()
     if (effectiveHeight / entitySpan >= 3 && rect().width() / stepSpan >= 3)
         return;
 
-    QString metric(options->metric);
-
     // Setup viewport
     int width = rect().width() - labelWidth;
     int height = effectiveHeight;
@@ -525,11 +624,7 @@ void StepVis::drawNativeGL()
                colorBarHeight,
                width,
                height);
-    glLoadIdentity();
-    glOrtho(0, effectiveSpan, 0, entitySpan, 0, 1);
 
-    float barwidth = 1.0;
-    float barheight = 1.0;
     entityheight = height/ entitySpan;
     stepwidth = width / effectiveSpan;
 
@@ -585,20 +680,31 @@ void StepVis::drawNativeGL()
         }
     }
 
-    // Generate buffers to hold each bar. We don't know how many there will
-    // be since we draw one per event.
-    QVector<GLfloat> bars = QVector<GLfloat>();
-    QVector<GLfloat> colors = QVector<GLfloat>();
-
-    // Process events for values
-    float x, y; // true position
-    float position; // placement of entity
-    QColor color;
-    float maxEntity = entitySpan + startEntity;
-    float myopacity, opacity_multiplier = 1.0;
+    float opacity_multiplier = 1.0;
     if (selected_gnome && !selected_entities.isEmpty())
         opacity_multiplier = 0.50;
-    std::cout << startStep << std::endl;
+
+    // Only rebuild the bars when what they show has changed, otherwise
+    // panning and zooming just move the projection
+    updateColors();
+    bool stale = barSettingsChanged();
+    if (!barBuffer->isValid() || stale
+        || barAggregateSteps != options->showAggregateSteps
+        || barGnome != selected_gnome || barEntities != selected_entities)
+    {
+        barAggregateSteps = options->showAggregateSteps;
+        barGnome = selected_gnome;
+        barEntities = selected_entities;
+        buildBars(opacity_multiplier);
+        ++frameStats.cacheMisses;
+    }
+    else
+    {
+        ++frameStats.cacheHits;
+    }
+
+    // Draw the bars of the partitions in view
+    int first = -1, last = -1;
     for (int i = startPartition; i < trace->partitions->length(); ++i)
     {
         part = trace->partitions->at(i);
@@ -606,98 +712,198 @@ void StepVis::drawNativeGL()
             break;
         else if (part->max_global_step < bottomStep)
             continue;
-        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list = part->events->begin();
-             event_list != part->events->end(); ++event_list)
+        if (first < 0)
+            first = i;
+        last = i;
+    }
+    if (first < 0)
+        return;
+
+    float left = startStep;
+    if (!(options->showAggregateSteps || !trace->use_aggregates))
+        left /= 2.0;
+    QMatrix4x4 projection;
+    projection.ortho(left, left + effectiveSpan,
+                     startEntity + entitySpan, startEntity, -1, 1);
+    barBuffer->draw(projection, partitionBars[first],
+                    partitionBars[last + 1] - partitionBars[first],
+                    opacity, xoffset, yoffset);
+    frameStats.eventsVisited += partitionBars[last + 1] - partitionBars[first];
+    frameStats.eventsDrawn += partitionBars[last + 1] - partitionBars[first];
+}
+
+// One bar per event and one per aggregate if shown, in partition order so
+// the partitions in view are a contiguous range. Bars are placed by step
+// and entity order; the view is applied as a projection when drawing.
+void StepVis::buildBars(float opacity_multiplier)
+{
+    float x, alpha;
+    unsigned long position;
+    QColor color;
+    Partition * part = NULL;
+    CommEvent * evt;
+    bool selected;
+
+    barBuffer->clear();
+    partitionBars.resize(trace->partitions->length() + 1);
+    for (int i = 0; i < trace->partitions->length(); ++i)
+    {
+        part = trace->partitions->at(i);
+        partitionBars[i] = barBuffer->numBars();
+        for (int step = part->min_global_step; step <= part->max_global_step;
+             ++step)
         {
-            bool selected = false;
-            if (part->gnome == selected_gnome
-                && selected_entities.contains(proc_to_order[event_list.key()]))
+            const StepBucket& bucket = stepIndex[i][step - part->min_global_step];
+            for (int e = 0; e < bucket.events.size(); ++e)
             {
-                selected = true;
-            }
+                evt = bucket.events[e];
+                position = bucket.orders[e];
+                selected = part->gnome == selected_gnome
+                           && selected_entities.contains(position);
+                alpha = selected ? 1.0 : opacity_multiplier;
 
-            position = proc_to_order[event_list.key()];
-            // Out of entity span check
-            if (position < floor(startEntity)
-                || position > ceil(startEntity + entitySpan))
-            {
-                 continue;
+                if (options->showAggregateSteps || !trace->use_aggregates)
+                    x = evt->step;
+                else
+                    x = evt->step / 2.0;
+
+                color = bucketColor(bucket.colors[e], 1.0);
+                barBuffer->addBar(x, position, 1, 1, color, alpha);
+
+                if (options->showAggregateSteps) // repeat!
+                {
+                    color = bucketColor(bucket.aggColors[e], 1.0);
+                    barBuffer->addBar(evt->step - 1, position, 1, 1, color,
+                                      alpha);
+                }
             }
-            y = (maxEntity - position) * barheight - 1;
+        }
+    }
+    partitionBars[trace->partitions->length()] = barBuffer->numBars();
+    barBuffer->upload();
+}
 
-            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-                 evt != (event_list.value())->end(); ++evt)
+// Add a bar's color to the average kept for an offscreen cell
+static void addToCell(QVector<float>& sums, QVector<int>& counts, int cell,
+                      const QColor& color, float alpha)
+{
+    sums[4 * cell] += color.red();
+    sums[4 * cell + 1] += color.green();
+    sums[4 * cell + 2] += color.blue();
+    sums[4 * cell + 3] += alpha;
+    counts[cell]++;
+}
+
+// Offscreen stand-in for drawNativeGL. Rather than draw every bar, the
+// bars in view are averaged into cells of at least a pixel which are then
+// drawn as one image over the event area.
+void StepVis::drawOffscreen(QPainter * painter)
+{
+    if (!visProcessed)
+        return;
+
+    drawColorBar(painter);
+
+    int effectiveHeight = rect().height() - colorBarHeight;
+    if (effectiveHeight / entitySpan >= 3 && rect().width() / stepSpan >= 3)
+        return;
+
+    int width = rect().width() - labelWidth;
+    int height = effectiveHeight;
+    float effectiveSpan = stepSpan;
+    if (!(options->showAggregateSteps) || trace->use_aggregates)
+        effectiveSpan /= 2.0;
+    float left = startStep;
+    if (!(options->showAggregateSteps || !trace->use_aggregates))
+        left /= 2.0;
+    entityheight = height/ entitySpan;
+    stepwidth = width / effectiveSpan;
+    if (width <= 0 || height <= 0)
+        return;
+
+    int columns = std::max(1, std::min(width, int(ceil(effectiveSpan))));
+    int rows = std::max(1, std::min(height, int(ceil(entitySpan))));
+    QVector<float> sums(4 * columns * rows, 0);
+    QVector<int> counts(columns * rows, 0);
+
+    float opacity_multiplier = 1.0;
+    if (selected_gnome && !selected_entities.isEmpty())
+        opacity_multiplier = 0.50;
+
+    updateColors();
+    Partition * part = NULL;
+    CommEvent * evt;
+    int topStep = boundStep(startStep + stepSpan) + 1;
+    int bottomStep = floor(startStep) - 1;
+    int firstStep, lastStep, first, last, column, row;
+    float x, alpha;
+    for (int i = startPartition; i < trace->partitions->length(); ++i)
+    {
+        part = trace->partitions->at(i);
+        if (part->min_global_step > topStep)
+            break;
+        else if (part->max_global_step < bottomStep)
+            continue;
+
+        firstStep = std::max(bottomStep, part->min_global_step);
+        lastStep = std::min(topStep, part->max_global_step);
+        for (int step = firstStep; step <= lastStep; ++step)
+        {
+            const StepBucket& bucket = stepIndex[i][step - part->min_global_step];
+            visibleBucketRange(bucket, first, last);
+            frameStats.eventsVisited += last - first;
+            for (int e = first; e < last; ++e)
             {
-                // Out of step span test
-                if ((*evt)->step < bottomStep || (*evt)->step > topStep)
+                evt = bucket.events[e];
+                row = floor((bucket.orders[e] - startEntity) / entitySpan
+                            * rows);
+                if (row < 0 || row >= rows)
                     continue;
+                alpha = opacity_multiplier;
+                if (part->gnome == selected_gnome
+                    && selected_entities.contains(bucket.orders[e]))
+                    alpha = 1.0;
 
-                // Calculate position of this bar in float space
                 if (options->showAggregateSteps || !trace->use_aggregates)
-                    x = ((*evt)->step - startStep) * barwidth;
+                    x = evt->step;
                 else
-                    x = ((*evt)->step - startStep) / 2 * barwidth;
-
-                color = options->colormap->color((*evt)->getMetric(metric));
-                if (selected)
-                    myopacity = opacity;
-                else
-                    myopacity = opacity * opacity_multiplier;
-
-                bars.append(x - xoffset);
-                bars.append(y - yoffset);
-                bars.append(x - xoffset);
-                bars.append(y + barheight + yoffset);
-                bars.append(x + barwidth + xoffset);
-                bars.append(y + barheight + yoffset);
-                bars.append(x + barwidth + xoffset);
-                bars.append(y - yoffset);
-                for (int j = 0; j < 4; ++j)
+                    x = evt->step / 2.0;
+                column = floor((x - left) / effectiveSpan * columns);
+                if (column >= 0 && column < columns)
                 {
-                    colors.append(color.red() / 255.0);
-                    colors.append(color.green() / 255.0);
-                    colors.append(color.blue() / 255.0);
-                    colors.append(myopacity);
+                    addToCell(sums, counts, row * columns + column,
+                              bucketColor(bucket.colors[e], 1.0), alpha);
+                    ++frameStats.eventsDrawn;
                 }
 
-
-                if (options->showAggregateSteps) // repeat!
+                if (options->showAggregateSteps)
                 {
-                    x = ((*evt)->step - startStep - 1) * barwidth;
-                    if (x + barwidth <= 0)
-                        continue;
-
-                    color = options->colormap->color((*evt)->getMetric(metric, true));
-
-                    bars.append(x - xoffset);
-                    bars.append(y - yoffset);
-                    bars.append(x - xoffset);
-                    bars.append(y + barheight + yoffset);
-                    bars.append(x + barwidth + xoffset);
-                    bars.append(y + barheight + yoffset);
-                    bars.append(x + barwidth + xoffset);
-                    bars.append(y - yoffset);
-                    for (int j = 0; j < 4; ++j)
-                    {
-                        colors.append(color.red() / 255.0);
-                        colors.append(color.green() / 255.0);
-                        colors.append(color.blue() / 255.0);
-                        colors.append(myopacity);
-                    }
+                    column = floor((evt->step - 1 - left) / effectiveSpan
+                                   * columns);
+                    if (column >= 0 && column < columns)
+                        addToCell(sums, counts, row * columns + column,
+                                  bucketColor(bucket.aggColors[e], 1.0),
+                                  alpha);
                 }
-
             }
         }
     }
 
-    // Draw
-    glEnableClientState(GL_COLOR_ARRAY);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glColorPointer(4,GL_FLOAT,0,colors.constData());
-    glVertexPointer(2,GL_FLOAT,0,bars.constData());
-    glDrawArrays(GL_QUADS,0,bars.size()/2);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
+    QImage image(columns, rows, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    int count;
+    for (int cell = 0; cell < counts.size(); ++cell)
+    {
+        count = counts[cell];
+        if (!count)
+            continue;
+        image.setPixel(cell % columns, cell / columns,
+                       qRgba(sums[4 * cell] / count,
+                             sums[4 * cell + 1] / count,
+                             sums[4 * cell + 2] / count,
+                             255 * sums[4 * cell + 3] / count));
+    }
+    painter->drawImage(QRectF(labelWidth, 0, width, height), image);
 }
 
 // Qt Event painting
@@ -731,7 +937,6 @@ void StepVis::paintEvents(QPainter * painter)
     stepwidth = blockwidth;
     QRect extents = QRect(0, 0, rect().width(), effectiveHeight);
 
-    QString metric(options->metric);
     int position;
     bool complete, aggcomplete;
     QSet<CommBundle *> drawComms = QSet<CommBundle *>();
@@ -765,8 +970,13 @@ void StepVis::paintEvents(QPainter * painter)
         tg_extent += tg.value()->entities->size();
     }
 
+    updateColors();
 
-    // Only do partitions in our range
+    // Only do partitions in our range, and within them only the buckets of
+    // visible steps and the visible entities in those
+    int firstStep, lastStep, first, last;
+    bool selected;
+    CommEvent * evt;
     for (int i = startPartition; i < trace->partitions->length(); ++i)
     {
         part = trace->partitions->at(i);
@@ -775,39 +985,25 @@ void StepVis::paintEvents(QPainter * painter)
         else if (part->max_global_step < bottomStep)
             continue;
 
-        // Go through events in partition
-        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
-             = part->events->begin();
-             event_list != part->events->end(); ++event_list)
+        firstStep = std::max(bottomStep, part->min_global_step);
+        lastStep = std::min(topStep, part->max_global_step);
+        for (int step = firstStep; step <= lastStep; ++step)
         {
-            bool selected = false;
-            if (part->gnome == selected_gnome
-                && selected_entities.contains(proc_to_order[event_list.key()]))
-            {
-                selected = true;
-            }
-
-            // Out of span test
-            position = proc_to_order[event_list.key()];
-            if (position < floor(startEntity)
-                || position > ceil(startEntity + entitySpan))
+            const StepBucket& bucket = stepIndex[i][step - part->min_global_step];
+            visibleBucketRange(bucket, first, last);
+            frameStats.eventsVisited += last - first;
+            for (int e = first; e < last; ++e)
             {
-                continue;
-            }
-            y = floor((position - startEntity) * blockheight) + 1;
+                evt = bucket.events[e];
+                position = bucket.orders[e];
+                selected = part->gnome == selected_gnome
+                           && selected_entities.contains(position);
+                y = floor((position - startEntity) * blockheight) + 1;
 
-            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-                 evt != (event_list.value())->end(); ++evt)
-            {
-                 // Out of step span test
-                if ((*evt)->step < bottomStep || (*evt)->step > topStep)
-                {
-                    continue;
-                }
                 // 0 = startEntity, effectiveHeight = stopEntity (startEntity + entitySpan)
                 // 0 = startStep, rect().width() = stopStep (startStep + stepSpan)
 
-                x = getX(*evt);
+                x = getX(evt);
                 w = barwidth;
                 h = barheight;
 
@@ -837,15 +1033,12 @@ void StepVis::paintEvents(QPainter * painter)
                     myopacity = 1.0;
                 painter->setPen(QPen(QColor(0, 0, 0, myopacity*255)));
                 // Draw the event
-                if ((*evt)->hasMetric(metric))
-                    painter->fillRect(QRectF(x, y, w, h),
-                                      QBrush(options->colormap->color((*evt)->getMetric(metric),
-                                                                      myopacity)));
-                else
-                    painter->fillRect(QRectF(x, y, w, h),
-                                      QBrush(QColor(180, 180, 180)));
+                painter->fillRect(QRectF(x, y, w, h),
+                                  QBrush(bucketColor(bucket.colors[e],
+                                                     myopacity)));
+                ++frameStats.eventsDrawn;
                 // Change pen color if selected
-                if (*evt == selected_event && !selected_aggregate)
+                if (evt == selected_event && !selected_aggregate)
                     painter->setPen(QPen(Qt::yellow));
                 // Draw border only if we're doing spacing, otherwise too messy
                 if (step_spacing > 0 && entity_spacing > 0)
@@ -856,22 +1049,22 @@ void StepVis::paintEvents(QPainter * painter)
                         incompleteBox(painter, x, y, w, h, &extents);
                 }
                 // Revert pen color
-                if (*evt == selected_event && !selected_aggregate)
+                if (evt == selected_event && !selected_aggregate)
                     painter->setPen(QPen(QColor(0, 0, 0)));
 
 
                 // Save messages for the end since they draw on top
-                (*evt)->addComms(&drawComms);
-                if (*evt == selected_event)
+                evt->addComms(&drawComms);
+                if (evt == selected_event)
                 {
                     if (overdraw_selected)
-                        overdraw_entities = (*evt)->neighborEntities();
-                    (*evt)->addComms(&selectedComms);
+                        overdraw_entities = evt->neighborEntities();
+                    evt->addComms(&selectedComms);
                 }
 
                 // Draw aggregate events if necessary
                 if (options->showAggregateSteps) {
-                    xa = floor(((*evt)->step - startStep - 1) * blockwidth) + 1
+                    xa = floor((evt->step - startStep - 1) * blockwidth) + 1
                          + labelWidth;
                     wa = barwidth;
                     if (xa + wa <= 0)
@@ -888,16 +1081,11 @@ void StepVis::paintEvents(QPainter * painter)
                     }
 
                     aggcomplete = aggcomplete && complete;
-                    if ((*evt)->hasMetric(metric))
-                        painter->fillRect(QRectF(xa, y, wa, h),
-                                          QBrush(options->colormap->color((*evt)->getMetric(metric,
-                                                                                            true),
-                                                                          myopacity)));
-                    else
-                        painter->fillRect(QRectF(xa, y, wa, h),
-                                          QBrush(QColor(180, 180, 180)));
+                    painter->fillRect(QRectF(xa, y, wa, h),
+                                      QBrush(bucketColor(bucket.aggColors[e],
+                                                         myopacity)));
 
-                    if (*evt == selected_event && selected_aggregate)
+                    if (evt == selected_event && selected_aggregate)
                         painter->setPen(QPen(Qt::yellow));
                     if (step_spacing > 0 && entity_spacing > 0)
                     {
@@ -906,16 +1094,15 @@ void StepVis::paintEvents(QPainter * painter)
                         else
                             incompleteBox(painter, xa, y, wa, h, &extents);
                     }
-                    if (*evt == selected_event && selected_aggregate)
+                    if (evt == selected_event && selected_aggregate)
                         painter->setPen(QPen(QColor(0, 0, 0)));
 
                     // For selection
-                    drawnEvents[*evt] = QRect(xa, y, (x - xa) + w, h);
+                    drawnEvents.insert(evt, QRect(xa, y, (x - xa) + w, h));
                 } else {
                     // For selection
-                    drawnEvents[*evt] = QRect(x, y, w, h);
+                    drawnEvents.insert(evt, QRect(x, y, w, h));
                 }
-
             }
         }
     }
@@ -934,19 +1121,7 @@ void StepVis::paintEvents(QPainter * painter)
         else
             ellipse_height = 3;
 
-        for (QSet<CommBundle *>::Iterator comm = drawComms.begin();
-             comm != drawComms.end(); ++comm)
-        {
-            if (!selectedComms.contains(*comm))
-                (*comm)->draw(painter, this);
-        }
-
-        // Now draw selected
-        for (QSet<CommBundle *>::Iterator comm = selectedComms.begin();
-             comm != selectedComms.end(); ++comm)
-        {
-            (*comm)->draw(painter, this);
-        }
+        paintComms(painter, drawComms, selectedComms);
     }
 
     if (selected_event && options->traceBack)
@@ -1100,6 +1275,13 @@ void StepVis::drawMessage(QPainter * painter, Message * msg)
         pencolor = Qt::yellow;
 
     QPointF p1, p2;
+    messageLine(msg, p1, p2);
+    painter->setPen(QPen(pencolor, penwidth, Qt::SolidLine));
+    drawLine(painter, &p1, &p2);
+}
+
+void StepVis::messageLine(Message * msg, QPointF& p1, QPointF& p2)
+{
     int y = getY(msg->sender);
     int x = getX(msg->sender);
     int w = blockwidth;
@@ -1118,8 +1300,6 @@ void StepVis::drawMessage(QPainter * painter, Message * msg)
         y = getY(msg->receiver);
         p2 = QPointF(x + w, y + h/2.0);
     }
-    painter->setPen(QPen(pencolor, penwidth, Qt::SolidLine));
-    drawLine(painter, &p1, &p2);
 }
 
 
@@ -1350,6 +1530,27 @@ void StepVis::drawColorBarGL()
     glDisable(GL_SCISSOR_TEST);
 }
 
+// Painter version of drawColorBarGL for offscreen rendering
+void StepVis::drawColorBar(QPainter * painter)
+{
+    int barWidth = (rect().width() - 400 > 0) ? rect().width() - 400
+                                              : rect().width() - 200;
+    int barMargin = 5;
+    int barHeight = colorBarHeight - 2*barMargin;
+    float segment_size = float(barWidth) / 101.0;
+    colorbar_offset = (rect().width() - segment_size * 101.0) / 2;
+
+    QLinearGradient gradient(colorbar_offset, 0,
+                             colorbar_offset + 100 * segment_size, 0);
+    for (int i = 0; i <= 100; i++)
+        gradient.setColorAt(i / 100.0,
+                            options->colormap->color(i / 100.0 * maxMetric));
+    painter->fillRect(QRectF(colorbar_offset,
+                             rect().height() - barMargin - barHeight,
+                             100 * segment_size, barHeight),
+                      QBrush(gradient));
+}
+
 // Labels for colorbar
 void StepVis::drawColorBarText(QPainter * painter)
 {
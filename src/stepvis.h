@@ -61,15 +61,18 @@ public slots:
 protected:
     void qtPaint(QPainter *painter);
     void drawNativeGL();
+    void drawOffscreen(QPainter *painter);
     void paintEvents(QPainter *painter);
     void prepaint();
     void overdrawSelected(QPainter *painter, QList<int> entities);
     void drawColorBarGL();
+    void drawColorBar(QPainter * painter);
     void drawColorBarText(QPainter * painter);
     void drawCollective(QPainter * painter, CollectiveRecord * cr,
                         int ellipse_width, int ellipse_height,
                         int effectiveHeight);
     void drawLine(QPainter * painter, QPointF * p1, QPointF * p2);
+    void messageLine(Message * msg, QPointF& p1, QPointF& p2);
     void drawArc(QPainter * painter, QPointF * p1, QPointF * p2,
                  int width, bool forward = true);
     void setupMetric();
@@ -79,6 +82,21 @@ protected:
     void drawPrimaryLabels(QPainter * painter, int effectiveHeight,
                            float barHeight);
 
+    // Events of each partition bucketed by global step, sorted by entity
+    // order within a bucket, so painting only touches what is on screen.
+    // Colors of the events and their aggregates are kept packed alongside.
+    class StepBucket {
+    public:
+        QVector<unsigned long> orders;
+        QVector<CommEvent *> events;
+        QVector<QRgb> colors;
+        QVector<QRgb> aggColors;
+    };
+    void buildStepIndex();
+    void updateColors();
+    void buildBars(float opacity_multiplier);
+    void visibleBucketRange(const StepBucket& bucket, int& first, int& last);
+
 private:
     double maxMetric;
     QString cacheMetric;
@@ -94,6 +112,19 @@ private:
     QMap<int, int> * overdrawYMap;
 
     QMap<int, QColor> * groupColorMap;
+    QVector<QVector<StepBucket> > stepIndex; // by partition, step - min step
+
+    // Metric and colormap state the bucket colors were computed with
+    QString colorMetric;
+    ColorMap * colorMap;
+    unsigned long colorVersion;
+
+    // First bar of each partition in the bar buffer, and the view state
+    // the bars were built with
+    QVector<int> partitionBars;
+    bool barAggregateSteps;
+    Gnome * barGnome;
+    QList<int> barEntities;
 
     static const int colorBarHeight = 24;
 };
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "tilecache.h"
+#include <QtConcurrent>
+
+uint qHash(const TileKey& key)
+{
+    return qHash(key.metric) ^ (key.xlevel << 24) ^ (key.ylevel << 16)
+           ^ (key.x * 31 + key.y);
+}
+
+TileCache::TileCache(QObject * parent)
+    : QObject(parent),
+      cache(tile_cache_kb),
+      pending(QMap<QFutureWatcher<QImage> *, PendingTile *>())
+{
+
+}
+
+TileCache::~TileCache()
+{
+    clear();
+}
+
+// Start rendering a tile unless it is already on its way. We take
+// ownership of the job.
+void TileCache::request(const TileKey& key, TileJob * job)
+{
+    for (QMap<QFutureWatcher<QImage> *, PendingTile *>::Iterator p
+         = pending.begin(); p != pending.end(); ++p)
+    {
+        if (p.value()->key == key)
+        {
+            delete job;
+            return;
+        }
+    }
+
+    QFutureWatcher<QImage> * watcher = new QFutureWatcher<QImage>();
+    connect(watcher, SIGNAL(finished()), this, SLOT(tileFinished()));
+    pending.insert(watcher, new PendingTile(key, job));
+    watcher->setFuture(QtConcurrent::run(job, &TileJob::render));
+}
+
+void TileCache::tileFinished()
+{
+    QFutureWatcher<QImage> * watcher
+            = static_cast<QFutureWatcher<QImage> *>(sender());
+    PendingTile * tile = pending.take(watcher);
+    if (!tile) // cleared while rendering
+        return;
+
+    QImage * image = new QImage(watcher->result());
+    cache.insert(tile->key, image, image->byteCount() / 1024 + 1);
+
+    delete tile->job;
+    delete tile;
+    watcher->deleteLater();
+    emit(tileReady());
+}
+
+// Drop everything, waiting for tiles in progress since their jobs may
+// refer to data the caller is about to change
+void TileCache::clear()
+{
+    for (QMap<QFutureWatcher<QImage> *, PendingTile *>::Iterator p
+         = pending.begin(); p != pending.end(); ++p)
+    {
+        p.key()->disconnect(this);
+        p.key()->waitForFinished();
+        delete p.value()->job;
+        delete p.value();
+        delete p.key();
+    }
+    pending.clear();
+    cache.clear();
+}
@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QImage>
+#include <QCache>
+#include <QMap>
+#include <QFutureWatcher>
+
+// Identifies a tile of a view: which metric it shows, the power of two
+// scale in each direction, and its position in tiles at that scale
+class TileKey {
+public:
+    TileKey(QString _metric, int _xlevel, int _ylevel, int _x, int _y)
+        : metric(_metric), xlevel(_xlevel), ylevel(_ylevel), x(_x), y(_y) {}
+
+    bool operator==(const TileKey& other) const
+    {
+        return x == other.x && y == other.y && xlevel == other.xlevel
+               && ylevel == other.ylevel && metric == other.metric;
+    }
+
+    QString metric;
+    int xlevel;
+    int ylevel;
+    int x;
+    int y;
+};
+
+uint qHash(const TileKey& key);
+
+// Renders one tile. Called on a worker thread, so it may only read data
+// that the view does not change while tiles are pending.
+class TileJob {
+public:
+    virtual ~TileJob() {}
+    virtual QImage render() = 0;
+};
+
+// Least recently used cache of rendered tiles for one view, bounded by
+// memory. Missing tiles are rendered on the global thread pool and
+// tileReady is emitted when each arrives.
+class TileCache : public QObject
+{
+    Q_OBJECT
+public:
+    TileCache(QObject * parent = 0);
+    ~TileCache();
+
+    QImage * tile(const TileKey& key) { return cache.object(key); }
+    void request(const TileKey& key, TileJob * job);
+    void clear();
+
+    static const int tile_size = 256;
+    static const int tile_cache_kb = 128 * 1024;
+
+signals:
+    void tileReady();
+
+private slots:
+    void tileFinished();
+
+private:
+    class PendingTile {
+    public:
+        PendingTile(TileKey _key, TileJob * _job)
+            : key(_key), job(_job) {}
+
+        TileKey key;
+        TileJob * job;
+    };
+
+    QCache<TileKey, QImage> cache;
+    QMap<QFutureWatcher<QImage> *, PendingTile *> pending;
+};
+
+#endif // TILECACHE_H
@@ -30,6 +30,8 @@
 #include <QMouseEvent>
 #include <QCursor>
 #include <QBitmap>
+#include <QHash>
+#include <QPainter>
 
 #include "trace.h"
 #include "event.h"
@@ -37,6 +39,11 @@
 #include "rpartition.h"
 #include "entity.h"
 #include "primaryentitygroup.h"
+#include "colormap.h"
+#include "barbuffer.h"
+#include "commbundle.h"
+#include "message.h"
+#include "p2pevent.h"
 
 TimelineVis::TimelineVis(QWidget* parent, VisOptions * _options)
     : VisWidget(parent = parent, _options),
@@ -63,7 +70,14 @@ TimelineVis::TimelineVis(QWidget* parent, VisOptions * _options)
       lastStartStep(0),
       idleFunction(-1),
       proc_to_order(QMap<unsigned long, unsigned long>()),
-      order_to_proc(QMap<unsigned long, unsigned long>())
+      order_to_proc(QMap<unsigned long, unsigned long>()),
+      barBuffer(new BarBuffer()),
+      barMetric(""),
+      barColorMap(NULL),
+      barColorMin(0),
+      barColorMax(0),
+      barColorClamp(0),
+      barColorByMetric(false)
 {
     setMouseTracking(true);
     cursorWidth = 16;
@@ -75,11 +89,172 @@ TimelineVis::TimelineVis(QWidget* parent, VisOptions * _options)
 
 TimelineVis::~TimelineVis()
 {
+    makeCurrent();
+    delete barBuffer;
+}
+
+// Whether the metric or color range changed since the GL bars were built,
+// remembering the current ones for next time
+bool TimelineVis::barSettingsChanged()
+{
+    ColorMap * colormap = options->colormap;
+    bool changed = barMetric != options->metric
+                   || barColorMap != colormap
+                   || barColorMin != colormap->getMin()
+                   || barColorMax != colormap->getMax()
+                   || barColorClamp != colormap->getClamp()
+                   || barColorByMetric != options->colorTraditionalByMetric;
+
+    barMetric = options->metric;
+    barColorMap = colormap;
+    barColorMin = colormap->getMin();
+    barColorMax = colormap->getMax();
+    barColorClamp = colormap->getClamp();
+    barColorByMetric = options->colorTraditionalByMetric;
+    return changed;
+}
+
+// Used to keep message bins together in one hash key
+class MessageBin {
+public:
+    MessageBin() : count(0), x1(0), y1(0), x2(0), y2(0) {}
 
+    int count;
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+};
+
+// Pixel position to message bin index, kept within 16 bits
+static quint64 messageBinIndex(double position, int bin_size)
+{
+    double index = floor(position / bin_size) + 0x8000;
+    if (index < 0)
+        return 0;
+    if (index > 0xFFFF)
+        return 0xFFFF;
+    return quint64(index);
+}
+
+// Draw the comms gathered while painting events. Unselected messages are
+// culled if their line misses the view. When zoomed out far enough that
+// there are more than messageBinDensity messages per pixel column, the rest
+// are binned by both end points at a few pixels' resolution. Each bin is
+// drawn as one line weighted by how many messages it holds, so dense
+// all-to-all phases cost a line per bin rather than per message. Otherwise
+// every message gets its real line. Collectives and anything touching the
+// selection are always drawn individually.
+void TimelineVis::paintComms(QPainter * painter, QSet<CommBundle *>& comms,
+                             QSet<CommBundle *>& selected)
+{
+    QRect area = QRect(0, 0, rect().width(), getHeight());
+    QVector<Message *> visible = QVector<Message *>();
+    QVector<QPointF> ends = QVector<QPointF>(); // two per visible message
+    QPointF p1, p2;
+    frameStats.messagesVisited += comms.size();
+    for (QSet<CommBundle *>::Iterator comm = comms.begin();
+         comm != comms.end(); ++comm)
+    {
+        if (selected.contains(*comm))
+            continue;
+        if (!(*comm)->isMessage())
+        {
+            (*comm)->draw(painter, this);
+            ++frameStats.messagesDrawn;
+            continue;
+        }
+
+        Message * msg = static_cast<Message *>(*comm);
+        if (msg->sender == selected_event || msg->receiver == selected_event)
+        {
+            msg->draw(painter, this);
+            ++frameStats.messagesDrawn;
+            continue;
+        }
+
+        messageLine(msg, p1, p2);
+        if ((p1.x() < area.left() && p2.x() < area.left())
+            || (p1.x() > area.right() && p2.x() > area.right())
+            || (p1.y() < area.top() && p2.y() < area.top())
+            || (p1.y() > area.bottom() && p2.y() > area.bottom()))
+            continue;
+
+        visible.append(msg);
+        ends.append(p1);
+        ends.append(p2);
+    }
+
+    // Zoomed in, the real lines are cheap enough and worth seeing
+    if (visible.size() <= messageBinDensity * std::max(area.width(), 1))
+    {
+        for (QVector<Message *>::Iterator msg = visible.begin();
+             msg != visible.end(); ++msg)
+        {
+            (*msg)->draw(painter, this);
+        }
+        frameStats.messagesDrawn += visible.size();
+    }
+    else
+    {
+        paintMessageBins(painter, ends, area);
+    }
+
+    for (QSet<CommBundle *>::Iterator comm = selected.begin();
+         comm != selected.end(); ++comm)
+    {
+        (*comm)->draw(painter, this);
+    }
+    frameStats.messagesDrawn += selected.size();
+}
+
+// Both ends are in the key so messages sent together but received at very
+// different times (late receives) stay separate lines.
+void TimelineVis::paintMessageBins(QPainter * painter, QVector<QPointF>& ends,
+                                   QRect& area)
+{
+    QHash<quint64, MessageBin> bins = QHash<quint64, MessageBin>();
+    for (int i = 0; i < ends.size(); i += 2)
+    {
+        const QPointF& p1 = ends.at(i);
+        const QPointF& p2 = ends.at(i + 1);
+        quint64 key = (messageBinIndex(p1.y(), messageBinSize) << 48)
+                      | (messageBinIndex(p2.y(), messageBinSize) << 32)
+                      | (messageBinIndex(p1.x(), messageBinSize) << 16)
+                      | messageBinIndex(p2.x(), messageBinSize);
+        MessageBin& bin = bins[key];
+        bin.count++;
+        bin.x1 += p1.x();
+        bin.y1 += p1.y();
+        bin.x2 += p2.x();
+        bin.y2 += p2.y();
+    }
+
+    int penwidth = 1;
+    if (entitySpan <= 32)
+        penwidth = 2;
+    painter->save();
+    painter->setClipRect(area);
+    for (QHash<quint64, MessageBin>::Iterator bin = bins.begin();
+         bin != bins.end(); ++bin)
+    {
+        int count = bin.value().count;
+        int width = std::min(penwidth + int(log(double(count)) / log(2.0)),
+                             4 * penwidth);
+        painter->setPen(QPen(Qt::black, width, Qt::SolidLine));
+        painter->drawLine(QPointF(bin.value().x1 / count,
+                                  bin.value().y1 / count),
+                          QPointF(bin.value().x2 / count,
+                                  bin.value().y2 / count));
+    }
+    painter->restore();
+    frameStats.messagesDrawn += bins.size();
 }
 
 void TimelineVis::processVis()
 {
+    barBuffer->invalidate();
+
     for (QMap<int, Function *>::Iterator fxn = trace->functions->begin();
          fxn != trace->functions->end(); ++fxn)
     {
@@ -126,58 +301,55 @@ void TimelineVis::mouseDoubleClickEvent(QMouseEvent * event)
 
     int x = event->x();
     int y = event->y();
-    for (QMap<Event *, QRect>::Iterator evt = drawnEvents.begin();
-         evt != drawnEvents.end(); ++evt)
+    int hit = drawnEvents.find(x, y);
+    if (hit >= 0) // We've found the event
     {
-        if (evt.value().contains(x,y)) // We've found the event
+        const QRect& rect = drawnEvents.rectAt(hit);
+        if (drawnEvents.itemAt(hit) == selected_event) // We were in this event
         {
-            if (evt.key() == selected_event) // We were in this event
+            if (options->showAggregateSteps)
             {
-                if (options->showAggregateSteps)
+                // we're in the aggregate event
+                if (x < rect.x() + rect.width() / 2)
                 {
-                    // we're in the aggregate event
-                    if (x < evt.value().x() + evt.value().width() / 2)
+                    if (selected_aggregate)
                     {
-                        if (selected_aggregate)
-                        {
-                            selected_event = NULL;
-                            selected_aggregate = false;
-                        }
-                        else
-                        {
-                            selected_aggregate = true;
-                        }
+                        selected_event = NULL;
+                        selected_aggregate = false;
                     }
-                    else // We're in the normal event
+                    else
                     {
-                        if (selected_aggregate)
-                        {
-                            selected_aggregate = false;
-                        }
-                        else
-                        {
-                            selected_event = NULL;
-                        }
+                        selected_aggregate = true;
                     }
                 }
-                else
-                    selected_event = NULL;
-            }
-            else // This is a new event to us
-            {
-                // we're in the aggregate event
-                if (options->showAggregateSteps
-                    && x < evt.value().x() + evt.value().width() / 2)
-                {
-                    selected_aggregate = true;
-                }
-                else
+                else // We're in the normal event
                 {
-                    selected_aggregate = false;
+                    if (selected_aggregate)
+                    {
+                        selected_aggregate = false;
+                    }
+                    else
+                    {
+                        selected_event = NULL;
+                    }
                 }
-                selected_event = evt.key();
             }
-            break;
+            else
+                selected_event = NULL;
+        }
+        else // This is a new event to us
+        {
+            // we're in the aggregate event
+            if (options->showAggregateSteps
+                && x < rect.x() + rect.width() / 2)
+            {
+                selected_aggregate = true;
+            }
+            else
+            {
+                selected_aggregate = false;
+            }
+            selected_event = drawnEvents.itemAt(hit);
         }
     }
 
@@ -26,6 +26,13 @@
 #define TIMELINEVIS_H
 
 #include "viswidget.h"
+#include <QSet>
+#include <QPointF>
+#include <QVector>
+
+class BarBuffer;
+class ColorMap;
+class CommBundle;
 
 // Parent class for those who pan and zoom like a timeline view
 class TimelineVis : public VisWidget
@@ -50,6 +57,15 @@ protected:
     void drawHover(QPainter *painter);
     void drawEntityLabels(QPainter * painter, int effectiveHeight,
                           float barHeight);
+    bool barSettingsChanged();
+    void paintComms(QPainter * painter, QSet<CommBundle *>& comms,
+                    QSet<CommBundle *>& selected);
+    void paintMessageBins(QPainter * painter, QVector<QPointF>& ends,
+                          QRect& area);
+
+    // End points of the line drawn for a message
+    virtual void messageLine(Message * msg, QPointF& p1, QPointF& p2)
+        { Q_UNUSED(msg); Q_UNUSED(p1); Q_UNUSED(p2); }
 
     bool jumped;
     bool mousePressed;
@@ -77,7 +93,18 @@ protected:
     QMap<unsigned long, unsigned long> proc_to_order;
     QMap<unsigned long, unsigned long> order_to_proc;
 
+    // GL bars kept between paints and the settings they were built with
+    BarBuffer * barBuffer;
+    QString barMetric;
+    ColorMap * barColorMap;
+    double barColorMin;
+    double barColorMax;
+    double barColorClamp;
+    bool barColorByMetric;
+
     static const int spacingMinimum = 12;
+    static const int messageBinSize = 6; // pixels
+    static const int messageBinDensity = 2; // messages per column to bin at
 
 };
 #endif // TIMELINEVIS_H
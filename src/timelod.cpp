@@ -0,0 +1,325 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#include "timelod.h"
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
+
+#include "trace.h"
+#include "rpartition.h"
+#include "commevent.h"
+#include "ravelutils.h"
+
+// Functor to build each entity's pyramid in the thread pool
+struct BuildEntityLOD {
+    BuildEntityLOD(TimeLOD * _lod) : lod(_lod) {}
+    typedef void result_type;
+    void operator()(TimeLOD::EntityLOD * entity) const {
+        lod->buildLevels(entity);
+    }
+
+    TimeLOD * lod;
+};
+
+// Combine two neighboring bins into the bin covering both
+static void mergeBins(TimeLOD::Bin& parent, const TimeLOD::Bin& left,
+                      const TimeLOD::Bin& right)
+{
+    parent.count = left.count + right.count;
+    parent.coverage = (left.coverage + right.coverage) / 2;
+
+    if (left.function == right.function)
+    {
+        parent.function = left.function;
+        parent.function_coverage = (left.function_coverage
+                                    + right.function_coverage) / 2;
+    }
+    else if (left.function_coverage >= right.function_coverage)
+    {
+        parent.function = left.function;
+        parent.function_coverage = left.function_coverage / 2;
+    }
+    else
+    {
+        parent.function = right.function;
+        parent.function_coverage = right.function_coverage / 2;
+    }
+
+    parent.metric_count = left.metric_count + right.metric_count;
+    parent.sum_metric = left.sum_metric + right.sum_metric;
+    if (left.metric_count && right.metric_count)
+    {
+        parent.min_metric = std::min(left.min_metric, right.min_metric);
+        parent.max_metric = std::max(left.max_metric, right.max_metric);
+    }
+    else if (left.metric_count)
+    {
+        parent.min_metric = left.min_metric;
+        parent.max_metric = left.max_metric;
+    }
+    else
+    {
+        parent.min_metric = right.min_metric;
+        parent.max_metric = right.max_metric;
+    }
+}
+
+static bool binLessThan(const TimeLOD::Bin& b1, const TimeLOD::Bin& b2)
+{
+    return b1.index < b2.index;
+}
+
+static bool enterLessThan(const CommEvent * evt1, const CommEvent * evt2)
+{
+    return evt1->enter < evt2->enter;
+}
+
+TimeLOD::TimeLOD(Trace * _trace, QString _metric,
+                 unsigned long long _startTime, unsigned long long _stopTime)
+    : metric(_metric),
+      startTime(_startTime),
+      span(std::max(_stopTime, _startTime) - _startTime + 1),
+      max_levels(1),
+      num_levels(1),
+      entities(new QVector<EntityLOD *>())
+{
+    QElapsedTimer traceTimer;
+    qint64 traceElapsed;
+    traceTimer.start();
+
+    while (max_levels < lod_max_levels && binWidth(max_levels) >= 1)
+        max_levels++;
+
+    for (int i = 0; i < _trace->num_pes; i++)
+        entities->append(new EntityLOD());
+
+    // Group the events by the row they are drawn in
+    for (QList<Partition *>::Iterator part = _trace->partitions->begin();
+         part != _trace->partitions->end(); ++part)
+    {
+        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
+             = (*part)->events->begin(); event_list != (*part)->events->end();
+             ++event_list)
+        {
+            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
+                 evt != (event_list.value())->end(); ++evt)
+            {
+                if ((*evt)->pe < (unsigned long) entities->size())
+                    (*entities)[(*evt)->pe]->events.append(*evt);
+            }
+        }
+    }
+
+    QtConcurrent::blockingMap(*entities, BuildEntityLOD(this));
+
+    for (QVector<EntityLOD *>::Iterator entity = entities->begin();
+         entity != entities->end(); ++entity)
+    {
+        num_levels = std::max(num_levels, (*entity)->levels.size());
+    }
+
+    traceElapsed = traceTimer.nsecsElapsed();
+    RavelUtils::gu_printTime(traceElapsed, "LOD Pyramid: ");
+}
+
+TimeLOD::~TimeLOD()
+{
+    for (QVector<EntityLOD *>::Iterator entity = entities->begin();
+         entity != entities->end(); ++entity)
+    {
+        delete *entity;
+    }
+    delete entities;
+}
+
+// Fill the finest level the entity needs from its events, then halve our
+// way up. Bins without events are never made.
+void TimeLOD::buildLevels(EntityLOD * entity)
+{
+    qSort(entity->events.begin(), entity->events.end(), enterLessThan);
+    if (entity->events.isEmpty())
+        return;
+
+    int depth = 1;
+    while (depth < max_levels
+           && numBins(depth - 1) < lod_density_bins * entity->events.size())
+    {
+        depth++;
+    }
+    entity->levels.resize(depth);
+
+    QMap<int, Bin> finest = QMap<int, Bin>();
+    for (QVector<CommEvent *>::Iterator evt = entity->events.begin();
+         evt != entity->events.end(); ++evt)
+    {
+        addEvent(finest, depth - 1, *evt);
+    }
+    QVector<Bin>& bins = entity->levels[depth - 1];
+    bins.reserve(finest.size());
+    for (QMap<int, Bin>::Iterator bin = finest.begin();
+         bin != finest.end(); ++bin)
+    {
+        bins.append(bin.value());
+        bins.last().index = bin.key();
+    }
+
+    // Children are sorted, so siblings are next to each other
+    Bin empty;
+    for (int level = depth - 2; level >= 0; level--)
+    {
+        const QVector<Bin>& children = entity->levels.at(level + 1);
+        QVector<Bin>& parents = entity->levels[level];
+        parents.reserve(children.size() / 2 + 1);
+        for (int i = 0; i < children.size(); i++)
+        {
+            parents.append(Bin());
+            Bin& parent = parents.last();
+            const Bin& child = children.at(i);
+            if (child.index % 2 == 0 && i + 1 < children.size()
+                && children.at(i + 1).index == child.index + 1)
+            {
+                mergeBins(parent, child, children.at(i + 1));
+                i++;
+            }
+            else if (child.index % 2 == 0)
+            {
+                mergeBins(parent, child, empty);
+            }
+            else
+            {
+                mergeBins(parent, empty, child);
+            }
+            parent.index = child.index / 2;
+        }
+        parents.squeeze();
+    }
+}
+
+// Spread an event over the bins it touches at the given level. The dominant
+// function is tracked per piece, so a bin split between many short calls of
+// one function and a single longer call of another may favor the latter.
+void TimeLOD::addEvent(QMap<int, Bin>& bins, int level, CommEvent * evt)
+{
+    bool has_metric = evt->hasMetric(metric);
+    float value = has_metric ? evt->getMetric(metric) : 0;
+    double enter = evt->enter;
+    double exit = evt->exit;
+    double width = binWidth(level);
+
+    int last = findBin(level, evt->exit);
+    for (int i = findBin(level, evt->enter); i <= last; i++)
+    {
+        Bin& bin = bins[i];
+        double bin_start = startTime + i * width;
+        double overlap = (std::min(exit, bin_start + width)
+                          - std::max(enter, bin_start)) / width;
+        if (overlap < 0)
+            overlap = 0;
+
+        bin.count++;
+        bin.coverage = std::min(1.0, bin.coverage + overlap);
+        if (bin.function == evt->function)
+        {
+            bin.function_coverage += overlap;
+        }
+        else if (bin.function < 0 || overlap > bin.function_coverage)
+        {
+            bin.function = evt->function;
+            bin.function_coverage = overlap;
+        }
+
+        if (has_metric)
+        {
+            if (bin.metric_count == 0)
+            {
+                bin.min_metric = value;
+                bin.max_metric = value;
+            }
+            else
+            {
+                bin.min_metric = std::min(bin.min_metric, value);
+                bin.max_metric = std::max(bin.max_metric, value);
+            }
+            bin.sum_metric += value;
+            bin.metric_count++;
+        }
+    }
+}
+
+// The coarsest level whose bins are no wider than the given time per pixel,
+// or -1 if even the deepest level is too coarse and events must be drawn
+int TimeLOD::chooseLevel(double timePerPixel)
+{
+    if (binWidth(num_levels - 1) > timePerPixel)
+        return -1;
+
+    int level = 0;
+    while (binWidth(level) > timePerPixel)
+        level++;
+    return level;
+}
+
+unsigned long long TimeLOD::binStart(int level, int bin)
+{
+    return startTime
+            + static_cast<unsigned long long>(bin * binWidth(level));
+}
+
+int TimeLOD::findBin(int level, unsigned long long time)
+{
+    if (time <= startTime)
+        return 0;
+    double bin = (time - startTime) / binWidth(level);
+    if (bin >= numBins(level))
+        return numBins(level) - 1;
+    return int(bin);
+}
+
+// Position of the first stored bin at or after index
+int TimeLOD::lowerBin(const QVector<Bin> * bins, int index)
+{
+    Bin key;
+    key.index = index;
+    return std::lower_bound(bins->begin(), bins->end(), key, binLessThan)
+           - bins->begin();
+}
+
+// NULL if the entity is too sparse to have this level, then its events
+// should be drawn instead
+const QVector<TimeLOD::Bin> * TimeLOD::getLevel(unsigned long entity,
+                                                int level)
+{
+    if (entity >= (unsigned long) entities->size()
+        || level >= entities->at(entity)->levels.size())
+        return NULL;
+    return &(entities->at(entity)->levels.at(level));
+}
+
+const QVector<CommEvent *> * TimeLOD::getEvents(unsigned long entity)
+{
+    if (entity >= (unsigned long) entities->size())
+        return NULL;
+    return &(entities->at(entity)->events);
+}
@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory.
+//
+// This file is part of Ravel.
+// Written by Kate Isaacs, kisaacs@acm.org, All rights reserved.
+// LLNL-CODE-663885
+//
+// For details, see https://github.com/scalability-llnl/ravel
+// Please also see the LICENSE file for our notice and the LGPL.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License (as published by
+// the Free Software Foundation) version 2.1 dated February 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+#ifndef TIMELOD_H
+#define TIMELOD_H
+
+#include <QVector>
+#include <QString>
+#include <QMap>
+#include <cmath>
+
+class Trace;
+class CommEvent;
+
+// Multi-resolution summary of the communication events on each entity over
+// the whole trace time, like a mipmap pyramid. Level 0 is one bin covering
+// the trace, each level below doubles the bins. Only bins holding events
+// are stored, and each entity's pyramid goes only as deep as its event
+// count warrants, about lod_density_bins bins per event at the finest.
+// Zoomed in past that the entity's events are few enough to draw as is.
+// The physical timeline draws from the coarsest level whose bins are no
+// wider than a pixel instead of drawing every event.
+class TimeLOD
+{
+public:
+    TimeLOD(Trace * _trace, QString _metric, unsigned long long _startTime,
+            unsigned long long _stopTime);
+    ~TimeLOD();
+
+    class Bin {
+    public:
+        Bin() : index(0), function(-1), function_coverage(0), coverage(0),
+            count(0), metric_count(0), min_metric(0), max_metric(0),
+            sum_metric(0) {}
+
+        float average() const
+            { return metric_count ? sum_metric / metric_count : 0; }
+
+        int index; // position within its level
+        int function; // function covering the most time in this bin
+        float function_coverage; // fraction of bin covered by that function
+        float coverage; // fraction of bin covered by any event
+        unsigned int count; // event pieces falling in this bin
+        unsigned int metric_count; // pieces that had the metric
+        float min_metric;
+        float max_metric;
+        float sum_metric;
+    };
+
+    int chooseLevel(double timePerPixel);
+    int numLevels() { return num_levels; }
+    int numBins(int level) { return 1 << level; }
+    double binWidth(int level) { return ldexp(double(span), -level); }
+    unsigned long long binStart(int level, int bin);
+    int findBin(int level, unsigned long long time);
+    static int lowerBin(const QVector<Bin> * bins, int index);
+    const QVector<Bin> * getLevel(unsigned long entity, int level);
+    const QVector<CommEvent *> * getEvents(unsigned long entity);
+    QString getMetric() { return metric; }
+
+    static const int lod_max_levels = 25;
+    static const int lod_density_bins = 2;
+
+private:
+    class EntityLOD {
+    public:
+        EntityLOD() : events(QVector<CommEvent *>()),
+            levels(QVector<QVector<Bin> >()) {}
+
+        QVector<CommEvent *> events; // by enter time
+        QVector<QVector<Bin> > levels; // sparse, sorted by index
+    };
+
+    friend struct BuildEntityLOD;
+
+    void addEvent(QMap<int, Bin>& bins, int level, CommEvent * evt);
+    void buildLevels(EntityLOD * entity);
+
+    QString metric;
+    unsigned long long startTime;
+    unsigned long long span;
+    int max_levels; // no finer than one time unit per bin
+    int num_levels; // deepest of any entity
+    QVector<EntityLOD *> * entities;
+};
+
+#endif // TIMELOD_H
@@ -28,6 +28,9 @@
 #include <fstream>
 #include <QElapsedTimer>
 #include <QTime>
+#include <QFile>
+#include <QDataStream>
+#include <QtConcurrent>
 #include <cmath>
 #include <climits>
 #include <cfloat>
@@ -74,8 +77,13 @@ Trace::Trace(int nt, int np)
       roots(new QVector<QVector<Event *> *>(std::max(nt, np))),
       mpi_group(-1),
       global_max_step(-1),
+      saved_gnome_types(false),
       dag_entries(new QList<Partition *>()),
       dag_step_dict(new QMap<int, QSet<Partition *> *>()),
+      min_time(ULLONG_MAX),
+      max_time(0),
+      step_times(new QVector<StepTime>()),
+      step_metrics(new QMap<QString, QVector<StepMetric> *>()),
       isProcessed(false),
       totalTimer(QElapsedTimer())
 {
@@ -144,6 +152,14 @@ Trace::~Trace()
     }
     delete gnomes;
 
+    for (QMap<QString, QVector<StepMetric> *>::Iterator sm
+         = step_metrics->begin(); sm != step_metrics->end(); ++sm)
+    {
+        delete sm.value();
+    }
+    delete step_metrics;
+    delete step_times;
+
     for (QMap<int, EntityGroup *>::Iterator comm = entitygroups->begin();
          comm != entitygroups->end(); ++comm)
     {
@@ -211,6 +227,7 @@ void Trace::preprocess(ImportOptions * _options)
     qSort(partitions->begin(), partitions->end(),
           dereferencedLessThan<Partition>);
     addPartitionMetric(); // For debugging
+    calculate_step_times();
 
     isProcessed = true;
 
@@ -239,13 +256,26 @@ void Trace::preprocessFromSaved()
     set_partition_dag();
 
     emit(startClustering());
-    std::cout << "Gnomifying..." << std::endl;
     if (options.cluster)
-        gnomify();
+    {
+        if (loadClusters(clusterFileName(fullpath)))
+        {
+            std::cout << "Restored saved clusters" << std::endl;
+        }
+        else
+        {
+            std::cout << "Gnomifying..." << std::endl;
+            gnomify();
+        }
+    }
 
     qSort(partitions->begin(), partitions->end(),
           dereferencedLessThan<Partition>);
 
+    // Restored from the saved results unless they don't fit the steps
+    if (step_times->size() != std::max(global_max_step, 0) / 2 + 1)
+        calculate_step_times();
+
     isProcessed = true;
 
     traceElapsed = traceTimer.nsecsElapsed();
@@ -262,7 +292,8 @@ void Trace::gnomify()
 
     traceTimer.start();
 
-    if (!options.seedClusters)
+    // Saves carry the seed they were clustered with
+    if (!options.seedClusters && options.origin != ImportOptions::OF_SAVE_OTF2)
     {
         QTime time = QTime::currentTime();
         qsrand((uint)time.msec());
@@ -282,16 +313,18 @@ void Trace::gnomify()
     for (QList<Partition *>::Iterator part = partitions->begin();
          part != partitions->end(); ++part)
     {
-        (*part)->makeClusterVectors("Lateness");
         int num_steps = (*part)->max_global_step - (*part)->min_global_step;
         for (int i = 0; i < gnomes->size(); i++)
         {
             gnome = gnomes->at(i);
-            if (gnome->detectGnome(*part))
+            // Saved results already know which gnome matched
+            if (saved_gnome_types ? (*part)->gnome_type == i
+                                  : gnome->detectGnome(*part))
             {
                 (*part)->gnome_type = i;
                 (*part)->gnome = gnome->create();
                 (*part)->gnome->set_seed(options.clusterSeed);
+                (*part)->gnome->set_max_clusters(options.maxClusters);
                 (*part)->gnome->setPartition(*part);
                 (*part)->gnome->setFunctions(functions);
                 if (options.origin != ImportOptions::OF_SAVE_OTF2)
@@ -305,6 +338,7 @@ void Trace::gnomify()
             (*part)->gnome_type = -1;
             (*part)->gnome = new Gnome();
             (*part)->gnome->set_seed(options.clusterSeed);
+            (*part)->gnome->set_max_clusters(options.maxClusters);
             (*part)->gnome->setPartition(*part);
             (*part)->gnome->setFunctions(functions);
             if (options.origin != ImportOptions::OF_SAVE_OTF2)
@@ -319,6 +353,128 @@ void Trace::gnomify()
     RavelUtils::gu_printTime(traceElapsed, "Gnomification/Clustering: ");
 }
 
+// Clusterings are saved beside the OTF2 anchor file, e.g. the clusterings
+// for run.otf2 are in run.clusters
+QString Trace::clusterFileName(QString otf2file)
+{
+    if (otf2file.endsWith(".otf2"))
+        otf2file.chop(5);
+    return otf2file + ".clusters";
+}
+
+// Write the gnome type and cluster tree of every partition along with the
+// seed. Partitions are written in their current order which is the phase
+// order the OTF2Exporter uses, so they line up again on load.
+bool Trace::saveClusters(QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        std::cout << "Could not write clusters to "
+                  << filename.toStdString().c_str() << std::endl;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << cluster_file_magic << cluster_file_version;
+    out << (qint64) options.clusterSeed << (qint32) partitions->size();
+    for (QList<Partition *>::Iterator part = partitions->begin();
+         part != partitions->end(); ++part)
+    {
+        out << (qint32) (*part)->gnome_type
+            << (qint32) (*part)->events->size()
+            << ((*part)->gnome != NULL);
+        if ((*part)->gnome)
+            (*part)->gnome->writeClusters(out);
+    }
+
+    file.close();
+    return out.status() == QDataStream::Ok;
+}
+
+// Recreate the gnomes from a file written by saveClusters. If anything does
+// not match the loaded partitions we give up and the caller reclusters.
+bool Trace::loadClusters(QString filename)
+{
+    QElapsedTimer traceTimer;
+    qint64 traceElapsed;
+
+    traceTimer.start();
+
+    QFile file(filename);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    qint32 version = 0, num_partitions = 0;
+    qint64 seed = 0;
+    in >> magic >> version;
+    if (magic != cluster_file_magic || version != cluster_file_version)
+        return false;
+    in >> seed >> num_partitions;
+    if (in.status() != QDataStream::Ok || num_partitions != partitions->size())
+        return false;
+
+    float stepPortion = 100.0 / global_max_step;
+    int total = 0;
+    bool valid = true;
+    qint32 gnome_type, num_entities;
+    bool has_gnome;
+    for (QList<Partition *>::Iterator part = partitions->begin();
+         part != partitions->end() && valid; ++part)
+    {
+        in >> gnome_type >> num_entities >> has_gnome;
+        if (in.status() != QDataStream::Ok || !has_gnome
+            || num_entities != (*part)->events->size()
+            || gnome_type < -1 || gnome_type >= gnomes->size()
+            || (saved_gnome_types && gnome_type != (*part)->gnome_type))
+        {
+            valid = false;
+            break;
+        }
+
+        (*part)->gnome_type = gnome_type;
+        if (gnome_type >= 0)
+            (*part)->gnome = gnomes->at(gnome_type)->create();
+        else
+            (*part)->gnome = new Gnome();
+        (*part)->gnome->set_seed(seed);
+        (*part)->gnome->set_max_clusters(options.maxClusters);
+        (*part)->gnome->setPartition(*part);
+        (*part)->gnome->setFunctions(functions);
+        valid = (*part)->gnome->preprocessFromSaved(in);
+
+        int num_steps = (*part)->max_global_step - (*part)->min_global_step;
+        total += stepPortion * num_steps;
+        emit(updateClustering(total));
+    }
+
+    if (!valid)
+    {
+        std::cout << "Saved clusters do not match trace, reclustering."
+                  << std::endl;
+        for (QList<Partition *>::Iterator part = partitions->begin();
+             part != partitions->end(); ++part)
+        {
+            delete (*part)->gnome;
+            (*part)->gnome = NULL;
+            if (!saved_gnome_types)
+                (*part)->gnome_type = 0;
+        }
+        return false;
+    }
+
+    options.clusterSeed = seed;
+    std::cout << "Clustering seed: " << options.clusterSeed << std::endl;
+
+    traceElapsed = traceTimer.nsecsElapsed();
+    RavelUtils::gu_printTime(traceElapsed, "Cluster restore: ");
+    return true;
+}
+
 void Trace::setGnomeMetric(Partition * part, int gnome_index)
 {
     for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
@@ -2961,6 +3117,148 @@ void Trace::set_dag_steps()
 }
 
 
+// Time extents of one partition's events, gathered in parallel and then
+// merged into the trace's
+class PartitionTimes {
+public:
+    PartitionTimes(Partition * _p = NULL)
+        : part(_p), min_time(ULLONG_MAX), max_time(0), first_step(0),
+          step_times(QVector<Trace::StepTime>()) {}
+
+    Partition * part;
+    unsigned long long min_time;
+    unsigned long long max_time;
+    int first_step; // global step / 2 of step_times[0]
+    QVector<Trace::StepTime> step_times;
+};
+
+struct CalculatePartitionTimes {
+    typedef void result_type;
+    void operator()(PartitionTimes& times) const {
+        Partition * part = times.part;
+        times.first_step = std::max(part->min_global_step, 0) / 2;
+        times.step_times.resize(std::max(part->max_global_step / 2
+                                         - times.first_step + 1, 0));
+        int step;
+        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
+             = part->events->begin();
+             event_list != part->events->end(); ++event_list)
+        {
+            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
+                 evt != (event_list.value())->end(); ++evt)
+            {
+                if ((*evt)->enter < times.min_time)
+                    times.min_time = (*evt)->enter;
+                if ((*evt)->exit > times.max_time)
+                    times.max_time = (*evt)->exit;
+
+                step = (*evt)->step / 2 - times.first_step;
+                if ((*evt)->step < 0 || step < 0
+                    || step >= times.step_times.size())
+                    continue;
+                Trace::StepTime& st = times.step_times[step];
+                if ((*evt)->enter < st.start)
+                    st.start = (*evt)->enter;
+                if ((*evt)->exit > st.stop)
+                    st.stop = (*evt)->exit;
+            }
+        }
+    }
+};
+
+// Time extents of the trace and of each event step, for views mapping
+// between steps and time. Partitions are scanned in parallel.
+void Trace::calculate_step_times()
+{
+    QElapsedTimer traceTimer;
+    qint64 traceElapsed;
+
+    traceTimer.start();
+
+    QVector<PartitionTimes> partition_times;
+    partition_times.reserve(partitions->size());
+    for (QList<Partition *>::Iterator part = partitions->begin();
+         part != partitions->end(); ++part)
+    {
+        partition_times.append(PartitionTimes(*part));
+    }
+    QtConcurrent::blockingMap(partition_times, CalculatePartitionTimes());
+
+    min_time = ULLONG_MAX;
+    max_time = 0;
+    step_times->fill(StepTime(), std::max(global_max_step, 0) / 2 + 1);
+    int step;
+    for (QVector<PartitionTimes>::Iterator times = partition_times.begin();
+         times != partition_times.end(); ++times)
+    {
+        if (times->min_time < min_time)
+            min_time = times->min_time;
+        if (times->max_time > max_time)
+            max_time = times->max_time;
+        for (int i = 0; i < times->step_times.size(); i++)
+        {
+            step = times->first_step + i;
+            if (step >= step_times->size())
+                break;
+            const StepTime& st = times->step_times.at(i);
+            if (st.start < (*step_times)[step].start)
+                (*step_times)[step].start = st.start;
+            if (st.stop > (*step_times)[step].stop)
+                (*step_times)[step].stop = st.stop;
+        }
+    }
+
+    traceElapsed = traceTimer.nsecsElapsed();
+    RavelUtils::gu_printTime(traceElapsed, "Step Times: ");
+}
+
+// Per-step summaries of a metric so views can draw the whole trace in
+// O(steps). Metrics don't change after preprocessing so we build each once.
+QVector<Trace::StepMetric> * Trace::getStepMetrics(QString metric)
+{
+    if (step_metrics->contains(metric))
+        return step_metrics->value(metric);
+
+    QVector<StepMetric> * steps
+            = new QVector<StepMetric>(global_max_step + 1);
+    for (QList<Partition *>::Iterator part = partitions->begin();
+         part != partitions->end(); ++part)
+    {
+        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
+             = (*part)->events->begin();
+             event_list != (*part)->events->end(); ++event_list)
+        {
+            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
+                 evt != (event_list.value())->end(); ++evt)
+            {
+                if ((*evt)->step < 0 || (*evt)->step > global_max_step
+                    || !(*evt)->hasMetric(metric))
+                {
+                    continue;
+                }
+
+                StepMetric& sm = (*steps)[(*evt)->step];
+                double value = (*evt)->getMetric(metric);
+                if (value > 0)
+                    sm.event_sum += value;
+                if (value > sm.event_max)
+                    sm.event_max = value;
+                sm.event_count++;
+
+                value = (*evt)->getMetric(metric, true);
+                if (value > 0)
+                    sm.agg_sum += value;
+                if (value > sm.agg_max)
+                    sm.agg_max = value;
+                sm.agg_count++;
+            }
+        }
+    }
+
+    step_metrics->insert(metric, steps);
+    return steps;
+}
+
 // In progress: will be used for extra information on aggregate events
 QList<Trace::FunctionPair> Trace::getAggregateFunctions(CommEvent * evt)
 {
@@ -34,6 +34,7 @@
 #include <QStack>
 #include <QSharedPointer>
 #include <QElapsedTimer>
+#include <climits>
 
 #include "importoptions.h"
 
@@ -59,6 +60,8 @@ public:
     void partition();
     void assignSteps();
     void gnomify();
+    bool saveClusters(QString filename);
+    static QString clusterFileName(QString otf2file);
     void mergePartitions(QList<QList<Partition *> *> * components);
     Event * findEvent(int entity, unsigned long long time);
 
@@ -97,6 +100,7 @@ public:
     int mpi_group; // functionGroup index of "MPI" functions
 
     int global_max_step; // largest global step
+    bool saved_gnome_types; // partition gnome_type restored by OTFConverter
     QList<Partition * > * dag_entries; // Leap 0 in the dag
     QMap<int, QSet<Partition *> *> * dag_step_dict; // Map leap to partition
 
@@ -122,6 +126,38 @@ public:
     };
     QList<FunctionPair> getAggregateFunctions(CommEvent *evt);
 
+    // Summary of a metric over all events at one global step. Events are
+    // only at even steps, their aggregates (odd step before) are kept with
+    // them. Sums only count positive values as that is what gets stacked.
+    class StepMetric {
+    public:
+        StepMetric()
+            : event_sum(0), event_max(0), event_count(0),
+              agg_sum(0), agg_max(0), agg_count(0) {}
+
+        double event_sum;
+        double event_max;
+        int event_count;
+        double agg_sum;
+        double agg_max;
+        int agg_count;
+    };
+    QVector<StepMetric> * getStepMetrics(QString metric);
+
+    // Time covered by the events of one event step, i.e. even global step
+    class StepTime {
+    public:
+        StepTime() : start(ULLONG_MAX), stop(0) {}
+
+        unsigned long long start;
+        unsigned long long stop;
+    };
+
+    // Set during preprocessing, or restored from the saved results
+    unsigned long long min_time; // earliest enter of any comm event
+    unsigned long long max_time; // latest exit of any comm event
+    QVector<StepTime> * step_times; // indexed by global step / 2
+
 signals:
     // This is for progress bars
     void updatePreprocess(int, QString);
@@ -176,6 +212,7 @@ private:
     void calculate_partition_lateness();
     void calculate_partition_duration();
     void calculate_partition_metrics();
+    void calculate_step_times();
 
     // For debugging
     void output_graph(QString filename, bool byparent = false);
@@ -184,6 +221,11 @@ private:
                               bool partition_verify = false,
                               bool partition_count = false);
 
+    // Restore clusterings written by saveClusters
+    bool loadClusters(QString filename);
+    static const quint32 cluster_file_magic = 0x52434c53; // "RCLS"
+    static const qint32 cluster_file_version = 3;
+
     // Extra metrics somewhat for debugging
     void setGnomeMetric(Partition * part, int gnome_index);
     void addPartitionMetric();
@@ -194,6 +236,9 @@ private:
                                               unsigned long long start,
                                               unsigned long long stop);
 
+    // Built on demand by getStepMetrics, indexed by global step
+    QMap<QString, QVector<StepMetric> *> * step_metrics;
+
     bool isProcessed; // Partitions exist
 
     QElapsedTimer totalTimer;
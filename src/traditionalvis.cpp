@@ -25,9 +25,11 @@
 #include "traditionalvis.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include <QFontMetrics>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <QtConcurrent>
 
 #include "trace.h"
 #include "rpartition.h"
@@ -41,6 +43,9 @@
 #include "primaryentitygroup.h"
 #include "p2pevent.h"
 #include "collectiveevent.h"
+#include "timelod.h"
+#include "barbuffer.h"
+#include "tilecache.h"
 
 TraditionalVis::TraditionalVis(QWidget * parent, VisOptions * _options)
     : TimelineVis(parent = parent, _options),
@@ -48,22 +53,29 @@ TraditionalVis::TraditionalVis(QWidget * parent, VisOptions * _options)
     maxTime(0),
     startTime(0),
     timeSpan(0),
-    stepToTime(new QVector<TimePair *>()),
+    stepToTime(NULL),
     lassoRect(QRect()),
-    blockheight(0)
+    blockheight(0),
+    entityRoots(new QVector<QVector<Event *> *>()),
+    entityRootExits(new QVector<QVector<unsigned long long> *>()),
+    lod(NULL),
+    lodWatcher(NULL),
+    partitionBars(QVector<int>()),
+    tiles(new TileCache()),
+    lodTiled(false)
 {
-
+    connect(tiles, SIGNAL(tileReady()), this, SLOT(update()));
 }
 
 TraditionalVis::~TraditionalVis()
 {
-    for (QVector<TimePair *>::Iterator itr = stepToTime->begin();
-         itr != stepToTime->end(); itr++)
-    {
-        delete *itr;
-        *itr = NULL;
-    }
-    delete stepToTime;
+    cancelLOD();
+    delete tiles; // waits on tiles reading the pyramid
+
+    clearRootIndex();
+    delete entityRoots;
+    delete entityRootExits;
+    delete lod;
 }
 
 void TraditionalVis::setTrace(Trace * t)
@@ -78,73 +90,22 @@ void TraditionalVis::setTrace(Trace * t)
     maxEntities = trace->num_pes;
     startPartition = 0;
 
-    // Determine/save time information
-    minTime = ULLONG_MAX;
-    maxTime = 0;
+    // Time information is gathered by the trace when it is processed
+    minTime = trace->min_time;
+    maxTime = trace->max_time;
+    maxStep = trace->global_max_step;
+    stepToTime = trace->step_times;
     startTime = ULLONG_MAX;
     unsigned long long stopTime = 0;
-    maxStep = trace->global_max_step;
-    for (QList<Partition*>::Iterator part = trace->partitions->begin();
-         part != trace->partitions->end(); ++part)
+    for (int i = 0; i < stepToTime->size(); i++)
     {
-        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
-             = (*part)->events->begin(); event_list != (*part)->events->end();
-             ++event_list)
-        {
-            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-                 evt != (event_list.value())->end(); ++evt)
-            {
-                if ((*evt)->exit > maxTime)
-                    maxTime = (*evt)->exit;
-                if ((*evt)->enter < minTime)
-                    minTime = (*evt)->enter;
-                if ((*evt)->step >= boundStep(startStep)
-                        && (*evt)->enter < startTime)
-                    startTime = (*evt)->enter;
-                if ((*evt)->step <= boundStep(stopStep)
-                        && (*evt)->exit > stopTime)
-                    stopTime = (*evt)->exit;
-            }
-        }
+        startTime = std::min(startTime, stepToTime->at(i).start);
+        if (2 * i <= boundStep(stopStep))
+            stopTime = std::max(stopTime, stepToTime->at(i).stop);
     }
     timeSpan = stopTime - startTime;
     stepSpan = stopStep - startStep;
 
-    // Clean up old
-    for (QVector<TimePair *>::Iterator itr = stepToTime->begin();
-         itr != stepToTime->end(); itr++)
-    {
-        delete *itr;
-        *itr = NULL;
-    }
-    delete stepToTime;
-
-    // Create time/step mapping
-    stepToTime = new QVector<TimePair *>();
-    for (int i = 0; i < maxStep/2 + 1; i++)
-        stepToTime->insert(i, new TimePair(ULLONG_MAX, 0));
-    int step;
-    for (QList<Partition*>::Iterator part = trace->partitions->begin();
-         part != trace->partitions->end(); ++part)
-    {
-        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
-             = (*part)->events->begin(); event_list != (*part)->events->end();
-             ++event_list)
-        {
-            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
-                 evt != (event_list.value())->end(); ++evt)
-            {
-                if ((*evt)->step < 0)
-                    continue;
-                step = (*evt)->step / 2;
-                if ((*stepToTime)[step]->start > (*evt)->enter)
-                    (*stepToTime)[step]->start = (*evt)->enter;
-                if ((*stepToTime)[step]->stop < (*evt)->exit)
-                    (*stepToTime)[step]->stop = (*evt)->exit;
-            }
-        }
-    }
-
     // Create processing element mapping
     proc_to_order = QMap<unsigned long, unsigned long>();
     order_to_proc = QMap<unsigned long, unsigned long>();
@@ -167,6 +128,108 @@ void TraditionalVis::setTrace(Trace * t)
         }
     }
 
+    buildRootIndex();
+
+    cancelLOD();
+    tiles->clear();
+    delete lod;
+    lod = NULL;
+    barBuffer->invalidate();
+}
+
+static TimeLOD * buildTimeLOD(Trace * trace, QString metric,
+                              unsigned long long start,
+                              unsigned long long stop)
+{
+    return new TimeLOD(trace, metric, start, stop);
+}
+
+// Start building the summary for the current metric unless one is already
+// on its way. Until it arrives the events are drawn as bars.
+void TraditionalVis::requestLOD()
+{
+    if (lodWatcher)
+        return;
+
+    lodWatcher = new QFutureWatcher<TimeLOD *>();
+    connect(lodWatcher, SIGNAL(finished()), this, SLOT(lodFinished()));
+    lodWatcher->setFuture(QtConcurrent::run(buildTimeLOD, trace,
+                                            options->metric, minTime,
+                                            maxTime));
+}
+
+// Swap in the new summary. If the metric changed while it was being built
+// the next paint will ask for another.
+void TraditionalVis::lodFinished()
+{
+    TimeLOD * built = lodWatcher->result();
+    lodWatcher->deleteLater();
+    lodWatcher = NULL;
+
+    tiles->clear();
+    delete lod;
+    lod = built;
+    if (!closed)
+        update();
+}
+
+// Wait out and drop a summary being built, as its trace is going away
+void TraditionalVis::cancelLOD()
+{
+    if (!lodWatcher)
+        return;
+
+    lodWatcher->disconnect(this);
+    lodWatcher->waitForFinished();
+    delete lodWatcher->result();
+    delete lodWatcher;
+    lodWatcher = NULL;
+}
+
+void TraditionalVis::clearRootIndex()
+{
+    for (QVector<QVector<Event *> *>::Iterator itr = entityRoots->begin();
+         itr != entityRoots->end(); ++itr)
+    {
+        delete *itr;
+    }
+    entityRoots->clear();
+
+    for (QVector<QVector<unsigned long long> *>::Iterator itr
+         = entityRootExits->begin(); itr != entityRootExits->end(); ++itr)
+    {
+        delete *itr;
+    }
+    entityRootExits->clear();
+}
+
+// Roots are appended as the importers find them, which is not necessarily
+// in time order (e.g. isends), so we keep our own sorted copy. The running
+// maximum of exit times is monotonic even if roots were to overlap, so a
+// lower bound search on it finds the first root that can reach the window.
+void TraditionalVis::buildRootIndex()
+{
+    clearRootIndex();
+
+    for (QVector<QVector<Event *> *>::Iterator roots = trace->roots->begin();
+         roots != trace->roots->end(); ++roots)
+    {
+        QVector<Event *> * sorted = new QVector<Event *>(**roots);
+        qSort(sorted->begin(), sorted->end(), Event::eventEnterLessThan);
+
+        QVector<unsigned long long> * exits
+                = new QVector<unsigned long long>(sorted->size());
+        unsigned long long max_exit = 0;
+        for (int i = 0; i < sorted->size(); i++)
+        {
+            if (sorted->at(i)->exit > max_exit)
+                max_exit = sorted->at(i)->exit;
+            (*exits)[i] = max_exit;
+        }
+
+        entityRoots->append(sorted);
+        entityRootExits->append(exits);
+    }
 }
 
 void TraditionalVis::mouseDoubleClickEvent(QMouseEvent * event)
@@ -176,21 +239,19 @@ void TraditionalVis::mouseDoubleClickEvent(QMouseEvent * event)
 
     int x = event->x();
     int y = event->y();
-    for (QMap<Event *, QRect>::Iterator evt = drawnEvents.begin();
-         evt != drawnEvents.end(); ++evt)
-        if (evt.value().contains(x,y))
+    int hit = drawnEvents.find(x, y);
+    if (hit >= 0)
+    {
+        if (drawnEvents.itemAt(hit) == selected_event)
         {
-            if (evt.key() == selected_event)
-            {
-                selected_event = NULL;
-            }
-            else
-            {
-                selected_aggregate = false;
-                selected_event = evt.key();
-            }
-            break;
+            selected_event = NULL;
+        }
+        else
+        {
+            selected_aggregate = false;
+            selected_event = drawnEvents.itemAt(hit);
         }
+    }
 
     changeSource = true;
     emit eventClicked(selected_event, false, false);
@@ -285,8 +346,9 @@ void TraditionalVis::mouseMoveEvent(QMouseEvent * event)
     {
         mousex = event->x();
         mousey = event->y();
-        if (hover_event == NULL
-                || !drawnEvents[hover_event].contains(mousex, mousey))
+        int hit = drawnEvents.find(mousex, mousey);
+        if (hover_event == NULL || hit < 0
+                || drawnEvents.itemAt(hit) != hover_event)
         {
             // Hover for all events! Note since we only save comm events in the
             // drawnEvents, this will recalculate for non-comm events each move
@@ -356,8 +418,8 @@ void TraditionalVis::setSteps(float start, float stop, bool jump)
     int starter = std::max(boundStep(start)/2, 0);
     if (starter >= stepToTime->size())
         starter = stepToTime->size() - 1;
-    startTime = (*stepToTime)[starter]->start;
-    timeSpan = (*stepToTime)[std::min(boundStep(stop)/2,  maxStep/2)]->stop
+    startTime = (*stepToTime)[starter].start;
+    timeSpan = (*stepToTime)[std::min(boundStep(stop)/2,  maxStep/2)].stop
             - startTime;
     jumped = jump;
 
@@ -375,7 +437,7 @@ void TraditionalVis::prepaint()
     int bottomStep = floor(startStep) - 1;
     // Fix bottomStep in the case where there are no steps in the view,
     // otherwise partition place will be lost
-    while (bottomStep > 0 && stepToTime->value(bottomStep/2)->stop > startTime)
+    while (bottomStep > 0 && stepToTime->value(bottomStep/2).stop > startTime)
        bottomStep -= 2;
     if (jumped) // We have to redo the active_partitions
     {
@@ -431,9 +493,16 @@ void TraditionalVis::prepaint()
 void TraditionalVis::drawNativeGL()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    lodTiled = false;
     if (!visProcessed)
         return;
 
+    if (barSettingsChanged())
+    {
+        barBuffer->invalidate();
+        tiles->clear();
+    }
+
     int effectiveHeight = rect().height() - timescaleHeight;
     if (effectiveHeight / entitySpan >= 3 && rect().width() / stepSpan >= 3)
         return;
@@ -457,6 +526,51 @@ void TraditionalVis::drawNativeGL()
     float barheight = 1.0;
     entityheight = height/ entitySpan;
 
+    // When many events share a pixel column, draw the summary instead. It
+    // is rendered into tiles in the background and drawn in qtPaint.
+    if (!lod || lod->getMetric() != options->metric)
+        requestLOD();
+    else if (lod->chooseLevel(timeSpan / 1.0 / width) >= 0)
+    {
+        lodTiled = true;
+        updateStepsFromTime();
+        return;
+    }
+
+    // Bars kept on the GPU are placed relative to the trace start in single
+    // precision, so only very deep zooms into long traces rebuild per paint
+    if (timeSpan / 1.0 / width
+            >= (maxTime - minTime) / 1.0 / (1 << bar_precision_bits))
+    {
+        if (!barBuffer->isValid())
+        {
+            buildBars();
+            ++frameStats.cacheMisses;
+        }
+        else
+        {
+            ++frameStats.cacheHits;
+        }
+
+        int first = startPartition, last = startPartition;
+        int upperStep = startStep + stepSpan + 2;
+        while (last < trace->partitions->length()
+               && trace->partitions->at(last)->min_global_step <= upperStep)
+            last++;
+
+        QMatrix4x4 projection;
+        projection.ortho(startTime - minTime, startTime - minTime + timeSpan,
+                         startEntity + entitySpan, startEntity, -1, 1);
+        barBuffer->draw(projection, partitionBars[first],
+                        partitionBars[last] - partitionBars[first]);
+        frameStats.eventsVisited += partitionBars[last] - partitionBars[first];
+        frameStats.eventsDrawn += partitionBars[last] - partitionBars[first];
+
+        drawSelectedGL(barheight);
+        updateStepsFromTime();
+        return;
+    }
+
     // Generate buffers to hold each bar. We don't know how many there will
     // be since we draw one per event.
     QVector<GLfloat> bars = QVector<GLfloat>();
@@ -487,7 +601,7 @@ void TraditionalVis::drawNativeGL()
             for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
                  evt != (event_list.value())->end(); ++evt)
             {
-
+                ++frameStats.eventsVisited;
                 position = proc_to_order[(*evt)->pe];
                  // Out of entity span test
                 if (position < floor(startEntity)
@@ -552,6 +666,7 @@ void TraditionalVis::drawNativeGL()
     glColorPointer(3,GL_FLOAT,0,colors.constData());
     glVertexPointer(2,GL_FLOAT,0,bars.constData());
     glDrawArrays(GL_QUADS,0,bars.size()/2);
+    frameStats.eventsDrawn += bars.size() / 8;
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
     if (stopStep == 0 && startStep == maxStep)
@@ -562,12 +677,379 @@ void TraditionalVis::drawNativeGL()
     stepSpan = stopStep - startStep;
 }
 
+// One bar per event in partition order so the partitions in view are a
+// contiguous range. Bars are placed by time since the start of the trace
+// and entity order; the view is applied as a projection when drawing.
+void TraditionalVis::buildBars()
+{
+    QColor color;
+    Partition * part = NULL;
+    barBuffer->clear();
+    partitionBars.resize(trace->partitions->length() + 1);
+    for (int i = 0; i < trace->partitions->length(); ++i)
+    {
+        part = trace->partitions->at(i);
+        partitionBars[i] = barBuffer->numBars();
+        for (QMap<unsigned long, QList<CommEvent *> *>::Iterator event_list
+             = part->events->begin(); event_list != part->events->end();
+             ++event_list)
+        {
+            for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
+                 evt != (event_list.value())->end(); ++evt)
+            {
+                if (options->colorTraditionalByMetric
+                        && (*evt)->hasMetric(options->metric))
+                    color = options->colormap->color((*evt)->getMetric(options->metric));
+                else
+                    color = QColor(200, 200, 255);
+
+                barBuffer->addBar((*evt)->enter - minTime,
+                                  proc_to_order[(*evt)->pe],
+                                  (*evt)->exit - (*evt)->enter, 1, color);
+            }
+        }
+    }
+    partitionBars[trace->partitions->length()] = barBuffer->numBars();
+    barBuffer->upload();
+}
+
+// Without visiting individual events, get the steps in view from the
+// time mapping instead
+void TraditionalVis::updateStepsFromTime()
+{
+    unsigned long long stopTime = startTime + timeSpan;
+    int oldStart = startStep;
+    int oldStop = stepSpan + startStep;
+    int stopStep = 0;
+    startStep = maxStep;
+    for (int i = 0; i < stepToTime->size(); i++)
+    {
+        if (stepToTime->at(i).stop < startTime
+            || stepToTime->at(i).start > stopTime)
+            continue;
+        if (2 * i < startStep)
+            startStep = 2 * i;
+        if (2 * i > stopStep)
+            stopStep = 2 * i;
+    }
+    if (stopStep == 0 && startStep == maxStep)
+    {
+        stopStep = oldStop;
+        startStep = oldStart;
+    }
+    stepSpan = stopStep - startStep;
+}
+
+// Draw the selected event on top so it is not lost among the rest
+void TraditionalVis::drawSelectedGL(float barheight)
+{
+    if (!selected_event || !selected_event->isCommEvent())
+        return;
+
+    unsigned long long stopTime = startTime + timeSpan;
+    if (selected_event->exit < startTime || selected_event->enter > stopTime)
+        return;
+
+    float position = proc_to_order[selected_event->pe];
+    if (position < floor(startEntity)
+        || position > ceil(startEntity + entitySpan))
+        return;
+
+    float maxEntity = entitySpan + startEntity;
+    float y = (maxEntity - position) * barheight - 1;
+    float x = 0;
+    if (selected_event->enter > startTime)
+        x = selected_event->enter - startTime;
+    float w = std::min(selected_event->exit, stopTime) - startTime - x;
+
+    GLfloat bars[8] = { x, y, x, y + barheight,
+                        x + w, y + barheight, x + w, y };
+    glColor3f(1.0, 1.0, 0.0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2,GL_FLOAT,0,bars);
+    glDrawArrays(GL_QUADS,0,4);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+// Paints one tile of the summary. Everything it needs is copied in or
+// left unchanged by the vis while tiles are pending, as it runs off the
+// GUI thread. Bins are colored by their maximum metric value so that hot
+// spots are not averaged away, and faded toward the background by how
+// much of the bin is actually covered by events.
+class LODTileJob : public TileJob
+{
+public:
+    LODTileJob(TimeLOD * _lod, double _startTime, double _timePerPixel,
+               double _startEntity, double _entitiesPerPixel,
+               QMap<unsigned long, unsigned long> _order_to_proc,
+               int _num_entities, ColorMap * _colormap, bool _colorByMetric,
+               QColor _background)
+        : lod(_lod), startTime(_startTime), timePerPixel(_timePerPixel),
+          startEntity(_startEntity), entitiesPerPixel(_entitiesPerPixel),
+          order_to_proc(_order_to_proc), num_entities(_num_entities),
+          colormap(new ColorMap(*_colormap)), colorByMetric(_colorByMetric),
+          background(_background) {}
+    ~LODTileJob() { delete colormap; }
+
+    QImage render()
+    {
+        int size = TileCache::tile_size;
+        QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(background);
+        QPainter painter(&image);
+
+        int level = lod->chooseLevel(timePerPixel);
+        if (level < 0)
+            level = lod->numLevels() - 1;
+        double stopTime = startTime + size * timePerPixel;
+        int first_bin = lod->findBin(level, startTime);
+        int last_bin = lod->findBin(level, stopTime);
+        int first = std::max(int(floor(startEntity)), 0);
+        int last = std::min(int(ceil(startEntity + size * entitiesPerPixel)),
+                            num_entities - 1);
+        double h = std::max(1.0, 1.0 / entitiesPerPixel);
+        double x, y, w;
+        float opacity;
+        QColor color;
+        for (int i = first; i <= last; ++i)
+        {
+            y = (i - startEntity) / entitiesPerPixel;
+            const QVector<TimeLOD::Bin> * bins
+                    = lod->getLevel(order_to_proc.value(i), level);
+            if (!bins)
+            {
+                paintEvents(painter, order_to_proc.value(i), y, h, stopTime);
+                continue;
+            }
+
+            for (int j = TimeLOD::lowerBin(bins, first_bin);
+                 j < bins->size() && bins->at(j).index <= last_bin; ++j)
+            {
+                const TimeLOD::Bin& bin = bins->at(j);
+                x = (lod->binStart(level, bin.index) - startTime) / timePerPixel;
+                w = std::max(1.0, (lod->binStart(level, bin.index + 1) - startTime)
+                                  / timePerPixel - x);
+
+                if (colorByMetric && bin.metric_count > 0)
+                    color = colormap->color(bin.max_metric);
+                else
+                    color = QColor(200, 200, 255);
+                opacity = std::max(bin.coverage, 0.25f);
+                color = QColor(background.red() + opacity
+                               * (color.red() - background.red()),
+                               background.green() + opacity
+                               * (color.green() - background.green()),
+                               background.blue() + opacity
+                               * (color.blue() - background.blue()));
+
+                painter.fillRect(QRectF(x, y, w, h), color);
+            }
+        }
+        painter.end();
+        return image;
+    }
+
+private:
+    // Rows too sparse for the chosen level are drawn event by event
+    void paintEvents(QPainter& painter, unsigned long entity, double y,
+                     double h, double stopTime)
+    {
+        const QVector<CommEvent *> * events = lod->getEvents(entity);
+        if (!events || events->isEmpty())
+            return;
+
+        // Events are by enter, start with the one that may overlap us
+        int first = std::lower_bound(events->begin(), events->end(),
+                                     startTime, entersBefore)
+                    - events->begin();
+        if (first > 0)
+            first--;
+
+        double x, w;
+        QColor color;
+        for (int i = first; i < events->size(); ++i)
+        {
+            CommEvent * evt = events->at(i);
+            if (evt->enter > stopTime)
+                break;
+            if (evt->exit < startTime)
+                continue;
+
+            x = (evt->enter - startTime) / timePerPixel;
+            w = std::max(1.0, (evt->exit - evt->enter) / timePerPixel);
+            if (colorByMetric && evt->hasMetric(lod->getMetric()))
+                color = colormap->color(evt->getMetric(lod->getMetric()));
+            else
+                color = QColor(200, 200, 255);
+            painter.fillRect(QRectF(x, y, w, h), color);
+        }
+    }
+
+    static bool entersBefore(const CommEvent * evt, double time)
+    {
+        return evt->enter < time;
+    }
+
+    TimeLOD * lod;
+    double startTime;
+    double timePerPixel;
+    double startEntity;
+    double entitiesPerPixel;
+    QMap<unsigned long, unsigned long> order_to_proc;
+    int num_entities;
+    ColorMap * colormap;
+    bool colorByMetric;
+    QColor background;
+};
+
+// Offscreen stand-in for drawNativeGL. Whatever would be drawn with GL
+// bars or from the tiles is drawn from the tiles, rendered as needed.
+void TraditionalVis::drawOffscreen(QPainter * painter)
+{
+    Q_UNUSED(painter);
+    lodTiled = false;
+    if (!visProcessed)
+        return;
+
+    if (barSettingsChanged())
+    {
+        barBuffer->invalidate();
+        tiles->clear();
+    }
+
+    int effectiveHeight = rect().height() - timescaleHeight;
+    if (effectiveHeight / entitySpan >= 3 && rect().width() / stepSpan >= 3)
+        return;
+
+    entityheight = effectiveHeight / entitySpan;
+    // Nothing would deliver a background build here, so build in place
+    if (!lod || lod->getMetric() != options->metric)
+    {
+        cancelLOD();
+        tiles->clear();
+        delete lod;
+        lod = new TimeLOD(trace, options->metric, minTime, maxTime);
+    }
+    lodTiled = true;
+    updateStepsFromTime();
+}
+
+// Show the given stretch of time, with the steps following it
+void TraditionalVis::setTimeWindow(unsigned long long start,
+                                   unsigned long long stop)
+{
+    if (!visProcessed)
+        return;
+
+    startTime = std::max(start, minTime);
+    timeSpan = std::min(stop, maxTime) - startTime;
+    updateStepsFromTime();
+    jumped = true;
+
+    if (!closed)
+        repaint();
+}
+
+// Draw the summary tiles covering the view. Tiles are rendered at the power
+// of two scale at or just finer than the view and scaled down to it. Any we
+// don't have yet are requested, with a coarser cached tile standing in.
+void TraditionalVis::paintTiles(QPainter * painter)
+{
+    int effectiveHeight = rect().height() - timescaleHeight;
+    int size = TileCache::tile_size;
+    double timePerPixel = timeSpan / 1.0 / rect().width();
+    double entitiesPerPixel = entitySpan / effectiveHeight;
+    int xlevel = floor(log(timePerPixel) / log(2.0));
+    int ylevel = floor(log(entitiesPerPixel) / log(2.0));
+    double tileTime = ldexp(1.0, xlevel) * size;
+    double tileEntities = ldexp(1.0, ylevel) * size;
+    double offsetTime = startTime - double(minTime);
+
+    int firstX = std::max(0, int(floor(offsetTime / tileTime)));
+    int lastX = floor((offsetTime + timeSpan) / tileTime);
+    int firstY = std::max(0, int(floor(startEntity / tileEntities)));
+    int lastY = floor((startEntity + entitySpan) / tileEntities);
+
+    painter->save();
+    painter->setClipRect(0, 0, rect().width(), effectiveHeight);
+    for (int ty = firstY; ty <= lastY; ++ty)
+    {
+        for (int tx = firstX; tx <= lastX; ++tx)
+        {
+            QRectF target((tx * tileTime - offsetTime) / timePerPixel,
+                          (ty * tileEntities - startEntity) / entitiesPerPixel,
+                          tileTime / timePerPixel,
+                          tileEntities / entitiesPerPixel);
+            TileKey key(options->metric, xlevel, ylevel, tx, ty);
+            QImage * image = tiles->tile(key);
+            if (image)
+            {
+                painter->drawImage(target, *image);
+                ++frameStats.cacheHits;
+                continue;
+            }
+            ++frameStats.cacheMisses;
+
+            LODTileJob * job = new LODTileJob(lod,
+                                              minTime + tx * tileTime,
+                                              ldexp(1.0, xlevel),
+                                              ty * tileEntities,
+                                              ldexp(1.0, ylevel),
+                                              order_to_proc,
+                                              trace->num_pes,
+                                              options->colormap,
+                                              options->colorTraditionalByMetric,
+                                              backgroundColor);
+            if (offscreen)
+            {
+                // Nothing repaints offscreen when the tile is ready
+                painter->drawImage(target, job->render());
+                delete job;
+                continue;
+            }
+            tiles->request(key, job);
+
+            for (int up = 1; up <= tilePlaceholderLevels; ++up)
+            {
+                image = tiles->tile(TileKey(options->metric, xlevel + up,
+                                            ylevel + up, tx >> up, ty >> up));
+                if (image)
+                {
+                    int part = size >> up;
+                    painter->drawImage(target, *image,
+                                       QRectF((tx - ((tx >> up) << up)) * part,
+                                              (ty - ((ty >> up) << up)) * part,
+                                              part, part));
+                    break;
+                }
+            }
+        }
+    }
+
+    // The selection would otherwise be lost in its bin
+    if (selected_event && selected_event->isCommEvent()
+        && selected_event->exit >= startTime
+        && selected_event->enter <= startTime + timeSpan)
+    {
+        double x = (double(selected_event->enter) - startTime) / timePerPixel;
+        double w = std::max(1.0, (selected_event->exit
+                                  - selected_event->enter) / timePerPixel);
+        double y = (proc_to_order[selected_event->pe] - startEntity)
+                   / entitiesPerPixel;
+        painter->fillRect(QRectF(x, y, w, std::max(1.0, 1.0 / entitiesPerPixel)),
+                          QBrush(Qt::yellow));
+    }
+    painter->restore();
+}
+
 
 void TraditionalVis::qtPaint(QPainter *painter)
 {
     if(!visProcessed)
         return;
 
+    if (lodTiled)
+        paintTiles(painter);
     if ((rect().height() - timescaleHeight) / entitySpan >= 3)
         paintEvents(painter);
 
@@ -623,9 +1105,15 @@ void TraditionalVis::paintEvents(QPainter *painter)
     for (int i = start; i <= end; ++i)
     {
         position = order_to_proc[i];
-        QVector<Event *> * roots = trace->roots->at(i);
-        for (QVector<Event *>::Iterator root = roots->begin();
-             root != roots->end(); ++root)
+        QVector<Event *> * roots = entityRoots->at(i);
+        QVector<unsigned long long> * exits = entityRootExits->at(i);
+
+        // Skip straight to the first root that ends inside the window and
+        // stop at the first one that begins after it
+        QVector<Event *>::Iterator root = roots->begin()
+                + (std::lower_bound(exits->begin(), exits->end(), startTime)
+                   - exits->begin());
+        for ( ; root != roots->end() && (*root)->enter <= stopTime; ++root)
         {
             paintNotStepEvents(painter, *root, position, entity_spacing,
                                barheight, blockheight, &extents);
@@ -647,6 +1135,7 @@ void TraditionalVis::paintEvents(QPainter *painter)
             for (QList<CommEvent *>::Iterator evt = (event_list.value())->begin();
                  evt != (event_list.value())->end(); ++evt)
             {
+                ++frameStats.eventsVisited;
                 bool selected = false;
                 if (part->gnome == selected_gnome
                     && selected_entities.contains(proc_to_order[(*evt)->pe]))
@@ -772,7 +1261,8 @@ void TraditionalVis::paintEvents(QPainter *painter)
                     if (*evt == selected_event && !selected_aggregate)
                         painter->setPen(QPen(QColor(0, 0, 0)));
 
-                    drawnEvents[*evt] = QRect(x, y, w, h);
+                    drawnEvents.insert(*evt, QRect(x, y, w, h));
+                    ++frameStats.eventsDrawn;
 
                     unsigned long long drawnEnter = std::max(startTime, (*evt)->enter);
                     unsigned long long available_w = ((*evt)->exit - drawnEnter)
@@ -843,7 +1333,8 @@ void TraditionalVis::paintEvents(QPainter *painter)
                     if (*evt == selected_event && !selected_aggregate)
                         painter->setPen(QPen(QColor(0, 0, 0)));
 
-                    drawnEvents[*evt] = QRect(cx, y, cw, h);
+                    drawnEvents.insert(*evt, QRect(cx, y, cw, h));
+                    ++frameStats.eventsDrawn;
                 }
                 (*evt)->addComms(&drawComms);
                 if (*evt == selected_event)
@@ -857,18 +1348,7 @@ void TraditionalVis::paintEvents(QPainter *painter)
     // for overlap purposes
     if (options->showMessages != VisOptions::MSG_NONE)
     {
-        for (QSet<CommBundle *>::Iterator comm = drawComms.begin();
-             comm != drawComms.end(); ++comm)
-        {
-            if (!selectedComms.contains(*comm))
-                (*comm)->draw(painter, this);
-        }
-
-        for (QSet<CommBundle *>::Iterator comm = selectedComms.begin();
-             comm != selectedComms.end(); ++comm)
-        {
-            (*comm)->draw(painter, this);
-        }
+        paintComms(painter, drawComms, selectedComms);
     }
 
     if (selected_event && options->traceBack)
@@ -898,14 +1378,20 @@ void TraditionalVis::drawMessage(QPainter * painter, Message * msg)
         pencolor = Qt::yellow;
 
 
+    QPointF p1, p2;
+    messageLine(msg, p1, p2);
+    painter->setPen(QPen(pencolor, penwidth, Qt::SolidLine));
+    painter->drawLine(p1, p2);
+}
+
+void TraditionalVis::messageLine(Message * msg, QPointF& p1, QPointF& p2)
+{
     int y = getY(msg->sender) + blockheight / 2;
     int x = getX(msg->sender);
-    QPointF p1 = QPointF(x, y);
+    p1 = QPointF(x, y);
     y = getY(msg->receiver) + blockheight / 2;
     x = getX(msg->receiver) + getW(msg->receiver);
-    QPointF p2 = QPointF(x, y);
-    painter->setPen(QPen(pencolor, penwidth, Qt::SolidLine));
-    painter->drawLine(p1, p2);
+    p2 = QPointF(x, y);
 }
 
 void TraditionalVis::drawCollective(QPainter * painter, CollectiveRecord * cr)
@@ -1042,8 +1528,9 @@ void TraditionalVis::drawDelayTracking(QPainter * painter, CommEvent * c)
 }
 
 
-// To make sure events have correct overlapping, this draws from the root down
-// TODO: Have a level cut off so we don't descend all the way down the tree
+// To make sure events have correct overlapping, this draws from the root down.
+// Callees lie within the span of their caller, so once an event is out of the
+// window or too narrow to draw, none of its subtree can be drawn either.
 void TraditionalVis::paintNotStepEvents(QPainter *painter, Event * evt,
                                         float position, int entity_spacing,
                                         float barheight, float blockheight,
@@ -1055,9 +1542,11 @@ void TraditionalVis::paintNotStepEvents(QPainter *painter, Event * evt,
         return; // Drawn later
 
     int x, y, w, h;
+    ++frameStats.eventsVisited;
     w = (evt->exit - evt->enter) / 1.0 / timeSpan * rect().width();
     if (w >= 2) // Don't draw tiny events
     {
+        ++frameStats.eventsDrawn;
         y = floor((position - startEntity) * blockheight) + 1;
         x = floor(static_cast<long long>(evt->enter - startTime) / 1.0
                   / timeSpan * rect().width()) + 1 + labelWidth;
@@ -1131,6 +1620,10 @@ void TraditionalVis::paintNotStepEvents(QPainter *painter, Event * evt,
         if (fxnRect.width() < available_w && fxnRect.height() < h)
             painter->drawText(x + 2, y + fxnRect.height(), fxnName);
     }
+    else
+    {
+        return; // Nothing below this is wide enough either
+    }
 
     for (QVector<Event *>::Iterator child = evt->callees->begin();
          child != evt->callees->end(); ++child)
@@ -26,9 +26,13 @@
 #define TRADITIONALVIS_H
 
 #include "timelinevis.h"
+#include "trace.h"
 #include <QVector>
+#include <QFutureWatcher>
 
 class CommEvent;
+class TimeLOD;
+class TileCache;
 
 // Physical timeline
 class TraditionalVis : public TimelineVis
@@ -39,6 +43,7 @@ public:
                    VisOptions *_options = new VisOptions());
     ~TraditionalVis();
     void setTrace(Trace * t);
+    void setTimeWindow(unsigned long long start, unsigned long long stop);
 
     void mouseMoveEvent(QMouseEvent * event);
     void wheelEvent(QWheelEvent * event);
@@ -48,6 +53,7 @@ public:
     void drawMessage(QPainter * painter, Message * message);
     void drawCollective(QPainter * painter, CollectiveRecord * cr);
     void drawDelayTracking(QPainter * painter, CommEvent * c);
+    void messageLine(Message * msg, QPointF& p1, QPointF& p2);
 
 
 signals:
@@ -56,6 +62,9 @@ signals:
 public slots:
     void setSteps(float start, float stop, bool jump = false);
 
+private slots:
+    void lodFinished();
+
 protected:
     void qtPaint(QPainter *painter);
 
@@ -64,6 +73,11 @@ protected:
 
     void prepaint();
     void drawNativeGL();
+    void drawOffscreen(QPainter * painter);
+    void paintTiles(QPainter * painter);
+    void drawSelectedGL(float barheight);
+    void updateStepsFromTime();
+    void buildBars();
 
     // Paint all other events available
     void paintNotStepEvents(QPainter *painter, Event * evt, float position,
@@ -71,24 +85,39 @@ protected:
                             float blockheight, QRect * extents);
 
 private:
-    // For keeping track of map betewen real time and step time
-    class TimePair {
-    public:
-        TimePair(unsigned long long _s1, unsigned long long _s2)
-            : start(_s1), stop(_s2) {}
-
-        unsigned long long start;
-        unsigned long long stop;
-    };
-
     unsigned long long minTime;
     unsigned long long maxTime;
     unsigned long long startTime;
     unsigned long long timeSpan;
-    QVector<TimePair* > * stepToTime;
+    // Map between real time and step time, kept by the trace
+    QVector<Trace::StepTime> * stepToTime;
     QRect lassoRect;
     float blockheight;
 
+    // Per-entity call tree roots sorted by enter time, with the running
+    // maximum exit so we can binary search for the first visible root
+    QVector<QVector<Event *> *> * entityRoots;
+    QVector<QVector<unsigned long long> *> * entityRootExits;
+
+    // Summary of events over time for drawing when zoomed out, built in
+    // the background so painting never waits on it
+    TimeLOD * lod;
+    QFutureWatcher<TimeLOD *> * lodWatcher;
+
+    // First bar of each partition in the bar buffer
+    QVector<int> partitionBars;
+    static const int bar_precision_bits = 20;
+
+    // Summary tiles rendered in the background when zoomed out
+    TileCache * tiles;
+    bool lodTiled;
+    static const int tilePlaceholderLevels = 3;
+
+    void buildRootIndex();
+    void clearRootIndex();
+    void requestLOD();
+    void cancelLOD();
+
     int getX(CommEvent * evt);
     int getY(CommEvent * evt);
     int getW(CommEvent * evt);
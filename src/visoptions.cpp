@@ -35,6 +35,7 @@ VisOptions::VisOptions(bool _showAgg,
       topByCentroid(false),
       showInactiveSteps(true),
       traceBack(false),
+      frameStats(STATS_NONE),
       metric(_metric),
       maptype(COLOR_DIVERGING),
       divergentmap(new ColorMap(QColor(173, 216, 230), 0)),
@@ -82,6 +83,7 @@ VisOptions::VisOptions(const VisOptions& copy)
     showInactiveSteps = copy.showInactiveSteps;
     topByCentroid = copy.topByCentroid;
     traceBack = copy.traceBack;
+    frameStats = copy.frameStats;
     metric = copy.metric;
     maptype = copy.maptype;
     divergentmap = new ColorMap(*(copy.divergentmap));
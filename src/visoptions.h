@@ -40,6 +40,7 @@ public:
 
     enum ColorMapType { COLOR_SEQUENTIAL, COLOR_DIVERGING, COLOR_CATEGORICAL };
     enum MessageType { MSG_NONE, MSG_TRUE, MSG_SINGLE };
+    enum FrameStatsType { STATS_NONE, STATS_OVERLAY, STATS_LOG };
 
     bool absoluteTime;
     bool showAggregateSteps;
@@ -48,6 +49,7 @@ public:
     bool topByCentroid; // focus processes are centroid of cluster
     bool showInactiveSteps; // default: no color for inactive proportion
     bool traceBack; // trace back idles and such
+    FrameStatsType frameStats; // show or log per-frame drawing statistics
     QString metric;
     ColorMapType maptype;
     ColorMap * divergentmap;
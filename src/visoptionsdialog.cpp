@@ -44,6 +44,9 @@ VisOptionsDialog::VisOptionsDialog(QWidget *parent, VisOptions * _options,
     ui->messageComboBox->addItem("No Messages");
     ui->messageComboBox->addItem("Across Steps");
     ui->messageComboBox->addItem("Within Step");
+    ui->statsComboBox->addItem("Off");
+    ui->statsComboBox->addItem("Overlay");
+    ui->statsComboBox->addItem("Log");
 
     connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(onOK()));
     connect(ui->buttonBox, SIGNAL(rejected()), this, SLOT(onCancel()));
@@ -63,6 +66,8 @@ VisOptionsDialog::VisOptionsDialog(QWidget *parent, VisOptions * _options,
             SLOT(onShowInactive(bool)));
     connect(ui->colorComboBox, SIGNAL(currentIndexChanged(QString)), this,
             SLOT(onColorCombo(QString)));
+    connect(ui->statsComboBox, SIGNAL(currentIndexChanged(int)), this,
+            SLOT(onFrameStats(int)));
 
     // We only have metrics if we have an active trace.
     if (trace)
@@ -140,6 +145,16 @@ void VisOptionsDialog::onShowInactive(bool showInactive)
     options->showInactiveSteps = showInactive;
 }
 
+void VisOptionsDialog::onFrameStats(int frameStats)
+{
+    if (frameStats == 0)
+        options->frameStats = VisOptions::STATS_NONE;
+    else if (frameStats == 1)
+        options->frameStats = VisOptions::STATS_OVERLAY;
+    else if (frameStats == 2)
+        options->frameStats = VisOptions::STATS_LOG;
+}
+
 void VisOptionsDialog::onColorCombo(QString type)
 {
     if (!isSet)
@@ -198,6 +213,13 @@ void VisOptionsDialog::setUIState()
     else
         ui->messageComboBox->setCurrentIndex(2);
 
+    if (options->frameStats == VisOptions::STATS_NONE)
+        ui->statsComboBox->setCurrentIndex(0);
+    else if (options->frameStats == VisOptions::STATS_OVERLAY)
+        ui->statsComboBox->setCurrentIndex(1);
+    else
+        ui->statsComboBox->setCurrentIndex(2);
+
 
     if (trace)
     {
@@ -57,6 +57,7 @@ public slots:
     void onShowMessages(int showMessages);
     void onColorCombo(QString type);
     void onShowInactive(bool showInactive);
+    void onFrameStats(int frameStats);
 
 private:
     int mapMetricToIndex(QString metric);
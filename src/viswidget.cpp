@@ -27,11 +27,13 @@
 #include <math.h>
 #include <climits>
 #include <cmath>
+#include <algorithm>
 
 #include <QVector>
 #include <QList>
 #include <QPaintEvent>
 #include <QLocale>
+#include <QElapsedTimer>
 
 #include "trace.h"
 #include "ravelutils.h"
@@ -47,7 +49,9 @@ VisWidget::VisWidget(QWidget *parent, VisOptions * _options) :
     selectColor(QBrush(Qt::yellow)),
     changeSource(false),
     border(20),
-    drawnEvents(QMap<Event *, QRect>()),
+    offscreen(false),
+    frameStats(FrameStats()),
+    drawnEvents(HitGrid<Event *>()),
     selected_entities(QList<int>()),
     selected_gnome(NULL),
     selected_event(NULL),
@@ -121,29 +125,106 @@ void VisWidget::prepaint()
 void VisWidget::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
+    frameStats.reset();
+    QElapsedTimer phaseTimer;
+    phaseTimer.start();
     prepaint();
+    frameStats.prepaintTime = phaseTimer.nsecsElapsed();
 
     // Clear
     qglClearColor(backgroundColor);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    phaseTimer.restart();
     beginNativeGL();
     {
         drawNativeGL();
     }
     endNativeGL();
+    frameStats.glTime = phaseTimer.nsecsElapsed();
 
     QPainter painter(this);
     //painter.begin(this);
     painter.setRenderHint(QPainter::Antialiasing);
+    phaseTimer.restart();
     qtPaint(&painter);
+    frameStats.qtTime = phaseTimer.nsecsElapsed();
+    reportFrameStats(&painter);
     painter.end();
 }
 
+// Draw the frame statistics in the corner of the view or print them,
+// depending on the options
+void VisWidget::reportFrameStats(QPainter * painter)
+{
+    if (options->frameStats == VisOptions::STATS_NONE)
+        return;
+
+    QStringList lines = frameStats.summary();
+    if (options->frameStats == VisOptions::STATS_LOG)
+    {
+        std::cout << metaObject()->className() << ": "
+                  << lines.join(", ").toStdString().c_str() << std::endl;
+        return;
+    }
+
+    painter->setFont(QFont("Helvetica", 10));
+    QFontMetrics font_metrics = painter->fontMetrics();
+    int lineHeight = font_metrics.height();
+    int textWidth = 0;
+    for (QStringList::Iterator line = lines.begin(); line != lines.end();
+         ++line)
+    {
+        textWidth = std::max(textWidth, font_metrics.width(*line));
+    }
+
+    QRect box(rect().width() - textWidth - 8, 0, textWidth + 8,
+              lineHeight * lines.size() + 4);
+    painter->fillRect(box, QBrush(QColor(255, 255, 255, 200)));
+    painter->setPen(QPen(Qt::black));
+    int y = box.y() + 2 + font_metrics.ascent();
+    for (QStringList::Iterator line = lines.begin(); line != lines.end();
+         ++line)
+    {
+        painter->drawText(box.x() + 4, y, *line);
+        y += lineHeight;
+    }
+}
+
 void VisWidget::drawNativeGL()
 {
 }
 
+// Same phases as paintEvent, except what would be drawn with GL is drawn by
+// drawOffscreen with the painter instead
+void VisWidget::paintOffscreen(QPainter * painter)
+{
+    offscreen = true;
+    frameStats.reset();
+    QElapsedTimer phaseTimer;
+    phaseTimer.start();
+    prepaint();
+    frameStats.prepaintTime = phaseTimer.nsecsElapsed();
+
+    painter->fillRect(rect(), backgroundColor);
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    phaseTimer.restart();
+    drawOffscreen(painter);
+    frameStats.glTime = phaseTimer.nsecsElapsed();
+
+    phaseTimer.restart();
+    qtPaint(painter);
+    frameStats.qtTime = phaseTimer.nsecsElapsed();
+    reportFrameStats(painter);
+    offscreen = false;
+}
+
+void VisWidget::drawOffscreen(QPainter *painter)
+{
+    Q_UNUSED(painter);
+}
+
 void VisWidget::beginNativeGL()
 {
     makeCurrent();
@@ -34,6 +34,8 @@
 
 #include "visoptions.h"
 #include "commdrawinterface.h"
+#include "hitgrid.h"
+#include "framestats.h"
 
 class VisOptions;
 class Trace;
@@ -60,6 +62,12 @@ public:
     void setVisOptions(VisOptions * _options);
     QWidget * container;
 
+    // Statistics of the most recently painted frame
+    const FrameStats& getFrameStats() { return frameStats; }
+
+    // Paint a frame with QPainter alone, e.g. into an image without a display
+    void paintOffscreen(QPainter * painter);
+
     virtual int getHeight() { return rect().height(); }
     virtual void drawMessage(QPainter * painter, Message * msg)
         { Q_UNUSED(painter); Q_UNUSED(msg); }
@@ -87,6 +95,7 @@ protected:
     int boundStep(float step); // Determine upper bound on step
 
     virtual void drawNativeGL();
+    virtual void drawOffscreen(QPainter *painter);
     virtual void qtPaint(QPainter *painter);
     virtual void prepaint();
     QString drawTimescale(QPainter * painter, unsigned long long start,
@@ -95,6 +104,7 @@ protected:
 private:
     void beginNativeGL();
     void endNativeGL();
+    void reportFrameStats(QPainter * painter);
 
 protected:
     Trace * trace;
@@ -104,9 +114,13 @@ protected:
     QBrush selectColor;
     bool changeSource;
     int border;
+    bool offscreen; // painting through paintOffscreen
+
+    // Filled in by the paint phases of subclasses, reset every frame
+    FrameStats frameStats;
 
     // Interactions
-    QMap<Event *, QRect> drawnEvents;
+    HitGrid<Event *> drawnEvents;
     QList<int> selected_entities;
     Gnome * selected_gnome;
     Event * selected_event;